@@ -0,0 +1,77 @@
+#include <Cosmos/wallet/split.hpp>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+// time generating output values with the cached inverse-CDF sampler and with
+// the old path, in which the mode was found by bisection for every split.
+// usage: cosmos_bench_sample (<number of values>)
+
+using namespace Cosmos;
+
+namespace {
+
+    using distribution = split::log_triangular_distribution;
+
+    template <typename F> double time (F f) {
+        auto began = std::chrono::steady_clock::now ();
+        f ();
+        return std::chrono::duration<double> (std::chrono::steady_clock::now () - began).count ();
+    }
+
+    double mean (const std::vector<double> &values) {
+        double total = 0;
+        for (double v : values) total += v;
+        return total / values.size ();
+    }
+
+    void report (const std::string &name, size_t count, double seconds, double sample_mean) {
+        std::cout << name << ": generated " << count << " values in " << seconds << " seconds";
+        if (seconds > 0) std::cout << " (" << (count / seconds) << " values per second)";
+        std::cout << " with mean " << sample_mean << std::endl;
+    }
+}
+
+int main (int argc, char **argv) {
+    try {
+        size_t count = argc > 1 ? std::stoul (argv[1]) : 1000000;
+        if (count == 0) throw exception {1} << "need at least one value";
+
+        double min = double (options::DefaultMinSatsPerOutput);
+        double max = double (options::DefaultMaxSatsPerOutput);
+        double expected_mean = options::DefaultMeanSatsPerOutput;
+
+        std::mt19937_64 engine {0};
+
+        // the old path solved for the mode again every time a split was constructed.
+        std::vector<double> old_values;
+        old_values.reserve (count);
+        double old_seconds = time ([&] {
+            for (size_t i = 0; i < count; i++) old_values.push_back (distribution {min, max, expected_mean} (engine));
+        });
+
+        std::vector<double> new_values;
+        new_values.reserve (count);
+        double new_seconds = time ([&] {
+            distribution::get (min, max, expected_mean).generate (engine, new_values, count);
+        });
+
+        report ("bisection per value", count, old_seconds, mean (old_values));
+        report ("cached inverse cdf ", count, new_seconds, mean (new_values));
+
+        std::cout << "expected mean " << expected_mean << std::endl;
+
+        // both must sample the same distribution, so with enough values the means should be close.
+        double difference = std::abs (mean (old_values) - mean (new_values));
+        if (count >= 100000 && difference > expected_mean * .01)
+            throw exception {2} << "sample means differ by " << difference;
+    } catch (const data::exception &x) {
+        std::cout << "Error: " << x.what () << std::endl;
+        return x.Code;
+    } catch (const std::exception &x) {
+        std::cout << "Error: " << x.what () << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include <Cosmos/wallet/sighash.hpp>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+// check that sighash_context writes the same preimages as Gigamonkey for
+// every forkid directive and time both on a tx with many inputs.
+// usage: cosmos_bench_sighash (<number of inputs>)
+
+using namespace Cosmos;
+
+namespace {
+
+    constexpr byte sighash_all {0x01};
+    constexpr byte sighash_none {0x02};
+    constexpr byte sighash_single {0x03};
+    constexpr byte sighash_fork_id {0x40};
+    constexpr byte sighash_anyone_can_pay {0x80};
+
+    // there are fewer outputs than inputs so that SIGHASH_SINGLE
+    // is tried for inputs with no matching output.
+    Bitcoin::incomplete::transaction make_tx (uint32 inputs) {
+        list<Bitcoin::incomplete::input> in;
+        for (uint32 i = 0; i < inputs; i++) in <<= Bitcoin::incomplete::input {Bitcoin::outpoint {Bitcoin::TXID {}, i}, i};
+
+        list<Bitcoin::output> out;
+        for (uint32 i = 0; i < 2; i++) out <<= Bitcoin::output {Bitcoin::satoshi {int64 (i) + 1000}, bytes (25, byte (i))};
+
+        return Bitcoin::incomplete::transaction {1, in, out, 0};
+    }
+
+    Bitcoin::satoshi value (uint32 i) {
+        return Bitcoin::satoshi {int64 (i) * 1000 + 546};
+    }
+
+    const bytes ScriptCode (25, byte {0xac});
+
+    // the number of preimages that disagree.
+    uint32 check (const Bitcoin::incomplete::transaction &tx, const sighash_context &context, uint32 inputs) {
+        uint32 failures = 0;
+        for (uint32 i = 0; i < inputs; i++) {
+            Bitcoin::sighash::document doc {tx, i, value (i), ScriptCode};
+            for (byte base : {sighash_all, sighash_none, sighash_single})
+                for (byte acp : {byte {0}, sighash_anyone_can_pay}) {
+                    auto d = static_cast<Bitcoin::sighash::directive> (base | sighash_fork_id | acp);
+                    if (context.preimage (i, value (i), ScriptCode, d) != Bitcoin::sighash::write (doc, d)) {
+                        std::cout << "preimages disagree for input " << i << " with directive " << uint32 (d) << std::endl;
+                        failures++;
+                    }
+                }
+        }
+
+        return failures;
+    }
+
+    template <typename F> double time (F f) {
+        auto began = std::chrono::steady_clock::now ();
+        f ();
+        return std::chrono::duration<double> (std::chrono::steady_clock::now () - began).count ();
+    }
+}
+
+int main (int argc, char **argv) {
+    try {
+        uint32 inputs = argc > 1 ? std::stoul (argv[1]) : 1000;
+        if (inputs < 3) throw exception {1} << "need at least 3 inputs";
+
+        Bitcoin::incomplete::transaction tx = make_tx (inputs);
+        auto d = static_cast<Bitcoin::sighash::directive> (sighash_all | sighash_fork_id);
+
+        // the edge cases only need a few inputs.
+        sighash_context small_context {make_tx (3)};
+        if (uint32 failures = check (make_tx (3), small_context, 3); failures > 0)
+            throw exception {2} << failures << " preimages disagree with Gigamonkey";
+
+        std::cout << "preimages agree with Gigamonkey for every forkid directive" << std::endl;
+
+        double ours = time ([&] {
+            sighash_context context {tx};
+            for (uint32 i = 0; i < inputs; i++) context.preimage (i, value (i), ScriptCode, d);
+        });
+
+        double theirs = time ([&] {
+            for (uint32 i = 0; i < inputs; i++)
+                Bitcoin::sighash::write (Bitcoin::sighash::document {tx, i, value (i), ScriptCode}, d);
+        });
+
+        std::cout << "wrote " << inputs << " preimages in " << ours << " seconds with sighash_context and " <<
+            theirs << " seconds with Bitcoin::sighash::write" << std::endl;
+    } catch (const data::exception &x) {
+        std::cout << "Error: " << x.what () << std::endl;
+        return x.Code;
+    } catch (const std::exception &x) {
+        std::cout << "Error: " << x.what () << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include <Cosmos/wallet/sign.hpp>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+// time signing a tx with many P2PKH inputs on one thread and on
+// every thread and check that both give the same tx.
+// usage: cosmos_bench_sign (<number of inputs>) (<number of threads>)
+
+using namespace Cosmos;
+
+namespace {
+
+    // the compressed WIF of secret key 1.
+    const std::string BenchKey {"KwDiBf89QgGbjEhKnhXJuH7LrciVrZi3qYjgd9M7rFU73sVHnoWn"};
+
+    // a P2PKH unlocking script is a signature and a compressed pubkey.
+    constexpr uint64 P2PKHScriptSize {107};
+
+    signable_transaction make_tx (const Bitcoin::secret &key, uint32 inputs) {
+        bytes script = pay_to_address::script (Gigamonkey::Hash160 (key.to_public ()));
+
+        std::vector<signer> signers;
+        signers.reserve (inputs);
+        for (uint32 i = 0; i < inputs; i++) signers.push_back (signer {
+            list<Bitcoin::secret> {key},
+            Bitcoin::prevout {Bitcoin::outpoint {Bitcoin::TXID {}, i}, Bitcoin::output {Bitcoin::satoshi {1000}, script}},
+            P2PKHScriptSize});
+
+        return signable_transaction {1, signers, {Bitcoin::output {Bitcoin::satoshi {int64 (inputs) * 1000 - 1000}, script}}, 0};
+    }
+
+    struct timed {
+        bytes Tx;
+        double Seconds;
+    };
+
+    timed sign (const signable_transaction &tx, uint32 threads) {
+        auto began = std::chrono::steady_clock::now ();
+        extended_transaction complete = tx.sign (Gigamonkey::redeem_p2pkh_and_p2pk, threads);
+        double seconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - began).count ();
+        if (!complete.valid ()) throw exception {1} << "invalid tx generated with " << threads << " threads";
+        return timed {bytes (Bitcoin::transaction (complete)), seconds};
+    }
+
+    void report (uint32 inputs, uint32 threads, double seconds) {
+        std::cout << "signed " << inputs << " inputs on " << threads << " threads in " << seconds << " seconds";
+        if (seconds > 0) std::cout << " (" << (inputs / seconds) << " inputs per second)";
+        std::cout << std::endl;
+    }
+}
+
+int main (int argc, char **argv) {
+    try {
+        uint32 inputs = argc > 1 ? std::stoul (argv[1]) : 1000;
+        uint32 threads = argc > 2 ? std::stoul (argv[2]) : default_threads ();
+
+        Bitcoin::secret key {BenchKey};
+        if (!key.valid ()) throw exception {1} << "invalid key";
+
+        signable_transaction tx = make_tx (key, inputs);
+
+        timed serial = sign (tx, 1);
+        report (inputs, 1, serial.Seconds);
+
+        timed parallel = sign (tx, threads);
+        report (inputs, threads, parallel.Seconds);
+
+        // signatures are deterministic, so the number of threads must not matter.
+        if (serial.Tx != parallel.Tx) throw exception {2} << "parallel signing does not give the same tx as serial signing";
+
+        std::cout << "serial and parallel txs are identical" << std::endl;
+    } catch (const data::exception &x) {
+        std::cout << "Error: " << x.what () << std::endl;
+        return x.Code;
+    } catch (const std::exception &x) {
+        std::cout << "Error: " << x.what () << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -6,16 +6,31 @@
 
 namespace Cosmos {
 
+    // one price per day, stored as a dense array starting at FirstDay.
     struct JSON_price_data : local_price_data {
-        // TODO we should probably stick to price data for the day rather than by the second.
-        std::map<Bitcoin::timestamp, double> Price;
+        constexpr static uint32 SecondsPerDay {86400};
+
+        // days since the epoch.
+        uint32 FirstDay {0};
+        // days for which we do not have a price are NaN.
+        std::vector<double> Daily {};
+
+        // ranges of days, first and last inclusive, that have been downloaded.
+        std::vector<std::pair<uint32, uint32>> Fetched {};
+
         maybe<double> get (const Bitcoin::timestamp &t) final override;
         void set (const Bitcoin::timestamp &t, double) final override;
+
+        bool fetched (uint32 day) final override;
+        void set_fetched (uint32 first_day, uint32 last_day) final override;
         JSON_price_data () {}
         JSON_price_data (const JSON &);
         explicit operator JSON () const;
+
+        static uint32 day (const Bitcoin::timestamp &t) {
+            return uint32 (t) / SecondsPerDay;
+        }
     };
 }
 
 #endif
-
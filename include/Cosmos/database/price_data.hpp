@@ -7,11 +7,21 @@ namespace Cosmos {
 
     struct price_data {
         virtual maybe<double> get (const Bitcoin::timestamp &t) = 0;
+
+        // make sure that we have prices for every day in a range so
+        // that they don't have to be downloaded one at a time.
+        virtual void prefetch (const Bitcoin::timestamp &from, const Bitcoin::timestamp &to) {}
+
         virtual ~price_data () {}
     };
 
     struct local_price_data : price_data {
         virtual void set (const Bitcoin::timestamp &t, double) = 0;
+
+        // days are counted since the epoch. We remember which days we have
+        // downloaded so that days with no price are not asked for again.
+        virtual bool fetched (uint32 day) = 0;
+        virtual void set_fetched (uint32 first_day, uint32 last_day) = 0;
         virtual ~local_price_data () {}
     };
 
@@ -19,6 +29,10 @@ namespace Cosmos {
         network &Net;
         local_price_data &Local;
         maybe<double> get (const Bitcoin::timestamp &t) final override;
+
+        // prices are downloaded a year at a time.
+        void prefetch (const Bitcoin::timestamp &from, const Bitcoin::timestamp &to) final override;
+
         cached_remote_price_data (network &n, local_price_data &l) : Net {n}, Local {l} {}
     };
 }
@@ -40,6 +40,22 @@ namespace Cosmos {
         extended_transaction Transaction;
         entry<Bitcoin::TXID, SPV::proof::tree> Proof;
 
+        // the position of a tx in the chain, computed once from its proof
+        // so that txs can be ordered without comparing proofs.
+        struct sort_key {
+            // block height, or the maximum for an unconfirmed tx.
+            uint64 Height;
+            // index in block, or for an unconfirmed tx, the length of
+            // the longest chain of unconfirmed txs that it depends on.
+            uint64 Position;
+
+            auto operator <=> (const sort_key &) const = default;
+
+            static sort_key make (const SPV::proof::tree &);
+        };
+
+        sort_key Key;
+
         vertex ();
         vertex (const extended_transaction &tx, const entry<Bitcoin::TXID, SPV::proof::tree> &pr);
 
@@ -178,6 +194,26 @@ namespace Cosmos {
 
         bool import_transaction (const Bitcoin::TXID &);
 
+        // a tx that has been downloaded but not yet checked or stored.
+        struct downloaded {
+            Bitcoin::TXID TXID;
+            bytes Transaction;
+            maybe<whatsonchain::merkle_proof> Proof;
+        };
+
+        // download a tx without touching the database, so that
+        // many can be downloaded at once on other threads.
+        static downloaded download (whatsonchain &, const Bitcoin::TXID &);
+
+        bool import_transaction (const downloaded &);
+
+        // check many txs at once. Txs that are already confirmed locally are
+        // skipped. The statuses of the others are downloaded in bulk and only
+        // proofs and txs that we don't have yet are downloaded after that.
+        // Returns the txs that are confirmed locally or that the network knows about.
+        // A tx that we have but which the network does not know is not returned.
+        set<Bitcoin::TXID> import_transactions (list<Bitcoin::TXID>);
+
         broadcast_tree_result broadcast (SPV::proof);
     };
 
@@ -189,10 +225,10 @@ namespace Cosmos {
         return Local.latest ();
     }
 
-    inline vertex::vertex (): Transaction {}, Proof {Bitcoin::TXID {}, {}} {}
+    inline vertex::vertex (): Transaction {}, Proof {Bitcoin::TXID {}, {}}, Key {0, 0} {}
 
     inline vertex::vertex (const extended_transaction &tx, const entry<Bitcoin::TXID, SPV::proof::tree> &pr):
-        Transaction {tx}, Proof {pr} {}
+        Transaction {tx}, Proof {pr}, Key {sort_key::make (pr.Value)} {}
 
     bool inline vertex::valid () const {
         return Proof.valid ();
@@ -204,7 +240,11 @@ namespace Cosmos {
 
     std::partial_ordering inline vertex::operator <=> (const vertex &tx) const {
         if (!valid () || !tx.valid ()) throw exception {} << "invalid tx.";
-        auto compare_tx = SPV::proof::ordering (Proof, tx.Proof);
+        if (auto compare_key = Key <=> tx.Key; compare_key != 0) return compare_key;
+        // unconfirmed txs at the same depth are ordered by txid.
+        if (Proof.Key < tx.Proof.Key) return std::partial_ordering::less;
+        if (tx.Proof.Key < Proof.Key) return std::partial_ordering::greater;
+        return std::partial_ordering::equivalent;
     }
 
     // whether a Merkle proof is included.
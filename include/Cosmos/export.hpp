@@ -0,0 +1,58 @@
+#ifndef COSMOS_EXPORT
+#define COSMOS_EXPORT
+
+#include <Cosmos/history.hpp>
+#include <Cosmos/ledger.hpp>
+#include <ostream>
+#include <concepts>
+
+namespace Cosmos {
+
+    enum class export_format {
+        csv,
+        // one JSON object per line.
+        ndjson
+    };
+
+    maybe<export_format> read_export_format (const std::string &);
+
+    // rows are written to the stream one at a time as they are generated,
+    // so the output is never held in memory. The history and ledger
+    // themselves are still loaded in full, since history.json is read
+    // all at once.
+    struct exporter {
+        std::ostream &Out;
+        export_format Format;
+
+        exporter (std::ostream &o, export_format f) : Out {o}, Format {f} {}
+
+        // one row for every event in the given range.
+        // Unconfirmed txs are included if the range has no end.
+        void history (const Cosmos::history &, when from = when::negative_infinity (), when to = when::infinity ());
+
+        // one row for every lot disposed of and every potential income in the given range.
+        void ledger (const Cosmos::ledger &, when from = when::negative_infinity (), when to = when::infinity ());
+
+    private:
+        std::vector<std::string> Columns {};
+
+        // for csv, writes the column names.
+        void begin (std::vector<std::string> columns);
+
+        // values that are not quoted are written as JSON numbers.
+        struct value {
+            std::string Value;
+            bool Quoted;
+
+            value (const std::string &x) : Value {x}, Quoted {true} {}
+            value (const char *x) : Value {x}, Quoted {true} {}
+            template <std::integral I> value (I x) : Value {std::to_string (x)}, Quoted {false} {}
+            value (double x);
+        };
+
+        void row (std::initializer_list<value>);
+    };
+
+}
+
+#endif
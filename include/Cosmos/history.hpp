@@ -9,6 +9,29 @@ namespace Cosmos {
     // This is how we build an account out of individual events.
     struct history {
 
+        // an event with everything we need to replay it, so that
+        // the tx it belongs to does not need to be looked up.
+        struct record {
+            // outpoint or inpoint.
+            Bitcoin::outpoint Point {};
+            direction Direction {direction::out};
+            Bitcoin::satoshi Value {0};
+            // for an input, the output that it redeems.
+            Bitcoin::outpoint Reference {};
+            // for an output, the output itself.
+            Bitcoin::output Output {};
+
+            record () {}
+            explicit record (const event &);
+
+            const Bitcoin::TXID &id () const {
+                return Point.Digest;
+            }
+
+            // look up the full tx.
+            event resolve (TXDB &) const;
+        };
+
         // All the events for a single transaction.
         struct tx {
             Bitcoin::TXID TXID {};
@@ -18,17 +41,29 @@ namespace Cosmos {
             Bitcoin::satoshi Spent {};
             Bitcoin::satoshi Moved {};
 
-            events Events {};
+            list<record> Events {};
 
             bool operator == (const tx &) const;
             std::partial_ordering operator <=> (const tx &) const;
             tx () {}
+
+            events resolve (TXDB &) const;
         };
 
+        using account = std::map<Bitcoin::outpoint, Bitcoin::output>;
+
         // account of the wallet after going through all the events.
-        std::map<Bitcoin::outpoint, Bitcoin::output> Account;
-        // events from latest to earliest.
-        stack<tx> Events;
+        account Account;
+        // events from earliest to latest.
+        std::vector<tx> Events;
+
+        // the account is saved before every CheckpointInterval txs so that
+        // we don't have to replay the whole history to get to a point in it.
+        constexpr static size_t CheckpointInterval {256};
+
+        // Checkpoints[n] is the account before Events[n * CheckpointInterval].
+        // Checkpoints are not saved but are regenerated when the history is read.
+        std::vector<account> Checkpoints;
 
         struct payment : payments::payment_request {
             list<Bitcoin::TXID> Transactions;
@@ -46,12 +81,12 @@ namespace Cosmos {
         Bitcoin::satoshi Spent;
         Bitcoin::satoshi Received;
 
-        history () : Account {}, Events {}, Value {0}, Spent {0}, Received {0} {}
-        history (std::map<Bitcoin::outpoint, Bitcoin::output> a, stack<tx> e,
-            Bitcoin::satoshi v, Bitcoin::satoshi spent, Bitcoin::satoshi received):
-            Account {a}, Events {e}, Value {v}, Spent {spent}, Received {received} {}
+        history () : Account {}, Events {}, Checkpoints {}, Value {0}, Spent {0}, Received {0} {}
 
-        // all events must be later than Latest.
+        // events may be given in any order and are grouped by tx and put
+        // in order of time. New events for a tx that we already have are
+        // added to it, since a tx can touch several address sequences, and
+        // if it was unconfirmed and now is not, it is moved.
         history &operator <<= (events e);
 
         explicit operator JSON () const;
@@ -60,15 +95,24 @@ namespace Cosmos {
         // a starting point and events following it, enough information
         // to generate a new account at the end of the range.
         struct episode {
-            std::map<Bitcoin::outpoint, Bitcoin::output> Account;
+            account Account;
             ordered_list<tx> History;
         };
 
-        // get all events within a given range.
+        // get all events within a given range. Only the events between the
+        // nearest checkpoint and the beginning of the range are replayed.
         episode get (when from = when::negative_infinity (), when to = when::infinity ()) const;
 
-        // through the history and try to find confirmations for all unconfirmed txs.
-        history update (TXDB &) const;
+        // look for confirmations for all unconfirmed txs and move
+        // the ones that have been mined to where they belong.
+        void update (TXDB &);
+
+        // apply the events of a single tx to an account.
+        static void apply (account &, const list<record> &);
+
+    private:
+        // regenerate the account and the checkpoints after Events[from] has changed.
+        void replay (size_t from);
     };
 }
 
@@ -0,0 +1,62 @@
+#ifndef COSMOS_LEDGER
+#define COSMOS_LEDGER
+
+#include <Cosmos/database/price_data.hpp>
+#include <Cosmos/history.hpp>
+
+namespace Cosmos {
+
+    // The cost basis of every output that we have received and every
+    // disposal of one, so that a tax report only needs to go over the
+    // txs in its period without looking up txs or prices.
+    struct ledger {
+
+        // an output along with the time and price at which we got it.
+        struct lot {
+            Bitcoin::satoshi Value;
+            Bitcoin::timestamp Acquired;
+            double Price;
+        };
+
+        // everything about a tx that matters for taxes.
+        struct entry {
+            Bitcoin::TXID TXID;
+            Bitcoin::timestamp When;
+            double Price;
+
+            // lots that were spent in this tx.
+            list<data::entry<Bitcoin::outpoint, lot>> Disposed;
+
+            // value received not counting what was moved from our own lots.
+            Bitcoin::satoshi Income;
+
+            // inputs of this tx that do not spend one of our lots.
+            list<Bitcoin::outpoint> Incoming;
+        };
+
+        // lots that have not been spent.
+        std::map<Bitcoin::outpoint, lot> Lots;
+
+        // from earliest to latest.
+        std::vector<entry> Entries;
+
+        // the number of history txs that have been added. Entries[n]
+        // is always for the history's Events[n].
+        size_t Processed;
+
+        ledger () : Lots {}, Entries {}, Processed {0} {}
+
+        // add txs from the history that have not been added yet. If the txs that
+        // we already have do not match the history, the ledger is built again.
+        // Unconfirmed txs have no time at which to look up the price, so they are
+        // left out; the number of them is returned. Call history::update first
+        // so that txs that have been mined since they were added have a time.
+        size_t update (const history &, price_data &);
+
+        explicit operator JSON () const;
+        explicit ledger (const JSON &);
+    };
+
+}
+
+#endif
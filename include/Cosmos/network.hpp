@@ -66,6 +66,9 @@ namespace Cosmos {
         net::HTTP::client_blocking CoinGecko;
         ARC::client TAAL;
 
+        // if false, we do not wait for the user before broadcasting.
+        bool Interactive {true};
+
         network () : IO {}, SSL {std::make_shared<net::HTTP::SSL> (net::HTTP::SSL::tlsv12_client)},
             WhatsOnChain {SSL}, Gorilla {SSL, net::HTTP::REST {"https", "mapi.gorillapool.io"}},
             CoinGecko {SSL, net::HTTP::REST {"https", "api.coingecko.com"}, tools::rate_limiter {1, 10}},
@@ -84,6 +87,10 @@ namespace Cosmos {
         broadcast_multiple_result broadcast (list<extended_transaction> tx);
 
         double price (const Bitcoin::timestamp &);
+
+        // prices over a range of time in a single request. For a range longer
+        // than 90 days, CoinGecko gives us one price per day.
+        list<entry<Bitcoin::timestamp, double>> price_range (const Bitcoin::timestamp &from, const Bitcoin::timestamp &to);
         
     };
     
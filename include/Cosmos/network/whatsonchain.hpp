@@ -33,6 +33,9 @@ namespace Cosmos {
 
         whatsonchain (ptr<net::HTTP::SSL> ssl) :
             net::HTTP::client_blocking {ssl, net::HTTP::REST {"https", "api.whatsonchain.com"}, tools::rate_limiter {3, 1}} {}
+        // several clients can be used at once with rate limits that add up to that of the API.
+        whatsonchain (ptr<net::HTTP::SSL> ssl, tools::rate_limiter r) :
+            net::HTTP::client_blocking {ssl, net::HTTP::REST {"https", "api.whatsonchain.com"}, r} {}
         whatsonchain (): net::HTTP::client_blocking {net::HTTP::REST {"https", "api.whatsonchain.com"}, tools::rate_limiter {3, 1}} {}
 
         static std::string write (const Bitcoin::TXID &);
@@ -49,6 +52,9 @@ namespace Cosmos {
             // txids of all transactions that spend to or redeem from a given address.
             list<Bitcoin::TXID> get_history (const Bitcoin::address &);
 
+            // only txs that are unconfirmed or were mined at or after the given height.
+            list<Bitcoin::TXID> get_history (const Bitcoin::address &, uint32 from_height);
+
             list<UTXO> get_unspent (const Bitcoin::address &);
 
             whatsonchain &API;
@@ -71,6 +77,18 @@ namespace Cosmos {
 
             maybe<merkle_proof> get_merkle_proof (const Bitcoin::TXID &);
 
+            struct status {
+                Bitcoin::TXID TXID;
+                // whether the network knows about this tx at all.
+                bool Known;
+                // the block that the tx was mined in, if it was.
+                maybe<digest256> BlockHash;
+                uint32 BlockHeight;
+            };
+
+            // the status of many txs at once. Requests are made for 20 txs at a time.
+            list<status> get_status (list<Bitcoin::TXID>);
+
             whatsonchain &API;
         };
 
@@ -102,6 +120,9 @@ namespace Cosmos {
             // by height
             header get_header (const N &);
 
+            // height of the latest block.
+            uint32 get_height ();
+
             whatsonchain &API;
         };
 
@@ -13,6 +13,8 @@ namespace Cosmos {
         constexpr static uint64 DefaultFeeRate[2] {10, 1000};
         constexpr static uint32 DefaultMaxLookAhead {10};
         constexpr static int64 DefaultMinChangeValue {100};
+        constexpr static uint32 DefaultMaxOutputsPerTx {1000};
+        constexpr static uint64 DefaultMaxTxSize {1000000};
 
         static satoshis_per_byte default_fee_rate () {
             static satoshis_per_byte dfr {Bitcoin::satoshi {static_cast<int64> (DefaultFeeRate[0])}, DefaultFeeRate[1]};
@@ -30,6 +32,10 @@ namespace Cosmos {
         satoshis_per_byte FeeRate {default_fee_rate ()};
 
         uint32 MaxLookAhead {DefaultMaxLookAhead};
+
+        uint32 MaxOutputsPerTx {DefaultMaxOutputsPerTx};
+
+        uint64 MaxTxSize {DefaultMaxTxSize};
     };
 }
 
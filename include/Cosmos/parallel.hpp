@@ -0,0 +1,59 @@
+#ifndef COSMOS_PARALLEL
+#define COSMOS_PARALLEL
+
+#include <Cosmos/types.hpp>
+#include <thread>
+#include <exception>
+#include <vector>
+
+namespace Cosmos {
+
+    uint32 inline default_threads () {
+        uint32 n = std::thread::hardware_concurrency ();
+        return n == 0 ? 1 : n;
+    }
+
+    // compute f (i) for every i in [0, n) on up to the given number of threads.
+    // The work is divided into contiguous blocks, so the result is always in
+    // index order and does not depend on the number of threads. If any call
+    // throws, the exception thrown for the lowest index is rethrown.
+    template <typename X, typename F>
+    std::vector<X> parallel_map (size_t n, F f, uint32 threads = default_threads ()) {
+        std::vector<X> results (n);
+        if (n == 0) return results;
+        if (threads < 1) threads = 1;
+        if (threads > n) threads = n;
+
+        if (threads == 1) {
+            for (size_t i = 0; i < n; i++) results[i] = f (i);
+            return results;
+        }
+
+        std::vector<std::exception_ptr> errors (threads);
+        std::vector<std::thread> workers;
+        workers.reserve (threads);
+
+        size_t block = n / threads;
+        size_t extra = n % threads;
+        size_t begin = 0;
+        for (uint32 t = 0; t < threads; t++) {
+            size_t end = begin + block + (t < extra ? 1 : 0);
+            workers.emplace_back ([&results, &errors, &f, t, begin, end] () {
+                try {
+                    for (size_t i = begin; i < end; i++) results[i] = f (i);
+                } catch (...) {
+                    errors[t] = std::current_exception ();
+                }
+            });
+            begin = end;
+        }
+
+        for (auto &w : workers) w.join ();
+        for (auto &e : errors) if (e) std::rethrow_exception (e);
+
+        return results;
+    }
+
+}
+
+#endif
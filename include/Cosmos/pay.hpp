@@ -47,16 +47,29 @@ namespace Cosmos {
             offer (const payment_request &in, const BEEF &tr, const list<account_diff> &d) : Request {in}, Transfer {tr}, Diff {d} {}
         };
 
+        // a payment made with txs that have been written unsigned to be
+        // signed somewhere else. The diffs do not have txids yet.
+        struct unsigned_offer {
+            payment_request Request;
+            list<account_diff> Diff;
+
+            unsigned_offer (const payment_request &in, const list<account_diff> &d) : Request {in}, Diff {d} {}
+        };
+
         // payment requests that have been made but not fulfilled.
         map<string, redeemable> Requests;
 
         // payments that have been sent but not accepted.
         map<string, offer> Proposals;
 
+        // payments that are waiting for their txs to be signed.
+        map<string, unsigned_offer> Unsigned;
+
         explicit operator JSON () const;
         explicit payments (const JSON &);
 
-        payments (map<string, redeemable> r, map<string, offer> p) : Requests {r}, Proposals {p} {}
+        payments (map<string, redeemable> r, map<string, offer> p, map<string, unsigned_offer> u) :
+            Requests {r}, Proposals {p}, Unsigned {u} {}
 
         struct new_request;
 
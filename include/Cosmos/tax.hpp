@@ -4,6 +4,8 @@
 #include <gigamonkey/satoshi.hpp>
 #include <Cosmos/database/price_data.hpp>
 #include <Cosmos/history.hpp>
+#include <Cosmos/ledger.hpp>
+#include <Cosmos/parallel.hpp>
 
 namespace Cosmos {
 
@@ -33,11 +35,11 @@ namespace Cosmos {
             // the price at the time of these events.
             double Price;
 
-            // list of incoming events for this tx.
+            // inpoints of the incoming events for this tx.
             // it is possible for the total value
             // of all these events to be greater than the
             // value of the total income.
-            events Incoming;
+            list<Bitcoin::outpoint> Incoming;
 
             potential_income (): TXID {}, Income {0}, Price {0}, Incoming {} {}
 
@@ -56,6 +58,11 @@ namespace Cosmos {
 
         static tax calculate (TXDB &, price_data *, const history::episode &);
 
+        // only goes over the ledger entries in the given range. Account is left empty.
+        // Each month is calculated separately on its own thread.
+        static tax calculate (const ledger &, when from = when::negative_infinity (), when to = when::infinity (),
+            uint32 threads = default_threads ());
+
         tax () : CapitalGain {}, Income {}, Account {} {}
 
         tax (const capital_gain &cg, list<potential_income> income, const account &a) :
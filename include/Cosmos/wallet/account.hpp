@@ -57,6 +57,30 @@ namespace Cosmos {
 
     };
 
+    // A mutable account that is used to apply many diffs in place.
+    // The persistent account is only constructed once, when finalize is called.
+    struct account_builder {
+        std::map<Bitcoin::outpoint, redeemable> Outputs;
+
+        account_builder () : Outputs {} {}
+        explicit account_builder (const account &);
+
+        // apply a diff in place. Throw account::cannot_apply_diff if the diff
+        // contains outpoints to be removed that are not in the account, in
+        // which case the builder is left unchanged.
+        account_builder &operator <<= (const account_diff &);
+
+        account_builder &operator += (const account &);
+
+        Bitcoin::satoshi value () const {
+            Bitcoin::satoshi v {0};
+            for (const auto &[key, value] : Outputs) v += value.Prevout.Value;
+            return v;
+        }
+
+        account finalize () const;
+    };
+
     account inline read_account_from_file (const std::string &filename) {
         return account (read_from_file (filename).Payload);
     }
@@ -0,0 +1,58 @@
+#ifndef COSMOS_WALLET_CONSOLIDATE
+#define COSMOS_WALLET_CONSOLIDATE
+
+#include <Cosmos/wallet/split.hpp>
+
+namespace Cosmos {
+
+    // the inverse of split. Merge many small outputs into a few larger ones.
+    struct consolidate {
+        // outputs with less than this value are merged.
+        Bitcoin::satoshi Threshold;
+        uint32 MaxOutputsPerTx;
+        uint64 MaxTxSize;
+
+        consolidate (
+            Bitcoin::satoshi threshold = options::DefaultMinSatsPerOutput,
+            uint32 max_outputs_per_tx = options::DefaultMaxOutputsPerTx,
+            uint64 max_tx_size = options::DefaultMaxTxSize) :
+            Threshold {threshold}, MaxOutputsPerTx {max_outputs_per_tx}, MaxTxSize {max_tx_size} {}
+
+        consolidate (Bitcoin::satoshi threshold, const options &o) :
+            consolidate {threshold, o.MaxOutputsPerTx, o.MaxTxSize} {}
+
+        // outputs grouped by script hash, since we want
+        // to redeem all identical scripts together.
+        using scripts = map<digest256, list<entry<Bitcoin::outpoint, redeemable>>>;
+
+        // all outputs below the threshold along with every other output
+        // having the same script, so that no script is left partially spent.
+        scripts select (const account &) const;
+
+        // pack scripts into txs no bigger than MaxTxSize. A script is only
+        // divided between txs if it cannot fit into a single tx by itself.
+        std::vector<list<entry<Bitcoin::outpoint, redeemable>>> pack (const scripts &) const;
+
+        struct result {
+            // these txs spend only outputs that are already in the wallet, so
+            // they can be broadcast in any order.
+            list<std::pair<extended_transaction, account_diff>> Transactions;
+            uint32 Last;
+        };
+
+        // the new outputs have values drawn from the given split.
+        result operator () (const split &, redeem, data::crypto::random &, keychain, pubkeys,
+            address_sequence, const scripts &, double fee_rate, uint32 threads = default_threads ()) const;
+
+        // the number of outputs a tx with this many inputs may create.
+        uint32 max_outputs (uint32 num_inputs) const {
+            return std::max<uint32> (1, std::min<uint32> (MaxOutputsPerTx, num_inputs / 2));
+        }
+
+        // whether a tx with these inputs and as many outputs as it might have fits.
+        bool fits (const size_estimator &) const;
+    };
+
+}
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef COSMOS_WALLET_ESTIMATE
+#define COSMOS_WALLET_ESTIMATE
+
+#include <Cosmos/options.hpp>
+#include <Cosmos/wallet/keys/redeemer.hpp>
+#include <cmath>
+
+namespace Cosmos {
+
+    // The serialized size and fee of a tx, computed from the expected sizes
+    // of its input scripts and from its outputs without building the tx.
+    // Inputs and outputs are added one at a time in constant time, so this
+    // can be kept up to date inside a loop that selects inputs.
+    struct size_estimator {
+        // the size of a P2PKH output.
+        constexpr static uint64 P2PKHOutputSize {34};
+
+        uint32 Inputs {0};
+        uint32 Outputs {0};
+        uint64 InputsSize {0};
+        uint64 OutputsSize {0};
+        Bitcoin::satoshi Spent {0};
+        Bitcoin::satoshi Sent {0};
+
+        size_estimator &add_input (const signing &x, Bitcoin::satoshi value) {
+            Inputs++;
+            InputsSize += x.expected_input_size ();
+            Spent += value;
+            return *this;
+        }
+
+        size_estimator &add_input (const redeemable &x) {
+            return add_input (x, x.Prevout.Value);
+        }
+
+        size_estimator &add_output (const Bitcoin::output &o) {
+            Outputs++;
+            OutputsSize += output_size (o.Script.size ());
+            Sent += o.Value;
+            return *this;
+        }
+
+        // version, locktime, and inputs.
+        uint64 size_without_outputs () const {
+            return 8 + Bitcoin::var_int::size (Inputs) + InputsSize;
+        }
+
+        uint64 size () const {
+            return size_without_outputs () + Bitcoin::var_int::size (Outputs) + OutputsSize;
+        }
+
+        Bitcoin::satoshi fee () const {
+            return Spent - Sent;
+        }
+
+        satoshis_per_byte fee_rate () const {
+            return satoshis_per_byte {fee (), size ()};
+        }
+
+        // the fee required for this tx at the given rate.
+        Bitcoin::satoshi required_fee (double rate) const {
+            return Bitcoin::satoshi {int64 (std::ceil (rate * size ()))};
+        }
+
+        static uint64 output_size (uint64 script_size) {
+            return 8 + Bitcoin::var_int::size (script_size) + script_size;
+        }
+
+        static uint64 p2pkh_input_size () {
+            return signing {{}, pay_to_address::redeem_expected_size ()}.expected_input_size ();
+        }
+    };
+
+}
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef COSMOS_WALLET_FAN_OUT
+#define COSMOS_WALLET_FAN_OUT
+
+#include <Cosmos/wallet/split.hpp>
+
+namespace Cosmos {
+
+    // Split outputs into more tiny outputs than can fit in one transaction.
+    // The first tx spends the given outputs and makes some tiny outputs or
+    // some intermediate outputs, each of which is split again by another tx,
+    // and so on. Every tx respects a maximum size and number of outputs.
+    struct fan_out {
+        uint32 MaxOutputsPerTx;
+        uint64 MaxTxSize;
+
+        fan_out (
+            uint32 max_outputs_per_tx = options::DefaultMaxOutputsPerTx,
+            uint64 max_tx_size = options::DefaultMaxTxSize) :
+            MaxOutputsPerTx {max_outputs_per_tx}, MaxTxSize {max_tx_size} {}
+
+        fan_out (const options &o) : fan_out {o.MaxOutputsPerTx, o.MaxTxSize} {}
+
+        // a planned transaction, which contains only values.
+        struct node {
+            // the value spent by this tx.
+            Bitcoin::satoshi Value;
+            // tiny outputs that will go into the wallet.
+            std::vector<Bitcoin::satoshi> Leaves;
+            // txs which each spend one intermediate output of this tx.
+            std::vector<node> Children;
+            Bitcoin::satoshi Fee;
+            // the position in the tx of each output, intermediate outputs first.
+            cross<size_t> Ordering;
+
+            uint32 outputs () const {
+                return Leaves.size () + Children.size ();
+            }
+
+            // number of txs in this tree.
+            uint32 transactions () const;
+
+            // number of tiny outputs in this tree.
+            uint32 leaves () const;
+
+            // number of addresses required by this tree, including intermediate outputs.
+            uint32 addresses () const;
+
+            Bitcoin::satoshi fees () const;
+        };
+
+        // plan the tree of txs. input_size is the expected size of the inputs of the
+        // root tx, which is all that differs between it and the rest of the txs.
+        node plan (const split &, data::crypto::random &, Bitcoin::satoshi value,
+            uint32 num_inputs, uint64 inputs_size, double fee_rate) const;
+
+        struct result {
+            // in an order such that every tx comes after the tx that it spends from.
+            list<std::pair<extended_transaction, account_diff>> Transactions;
+            uint32 Last;
+        };
+
+        // build and sign a planned tree. New outputs are assigned to addresses in x,
+        // exactly node::addresses () of them starting at x.Last. Since all random
+        // choices were made in the plan, trees can be built in parallel.
+        result build (const node &, redeem, keychain, pubkeys,
+            address_sequence x, list<entry<Bitcoin::outpoint, redeemable>> selected,
+            uint32 threads = default_threads ()) const;
+
+        result operator () (const split &s, redeem r, data::crypto::random &rand, keychain k, pubkeys p,
+            address_sequence x, list<entry<Bitcoin::outpoint, redeemable>> selected, double fee_rate) const;
+
+        // the maximum number of outputs for a tx with the given inputs.
+        uint32 max_outputs (uint32 num_inputs, uint64 inputs_size) const;
+
+        static uint64 size_without_outputs (uint32 num_inputs, uint64 inputs_size) {
+            return size_estimator {num_inputs, 0, inputs_size}.size_without_outputs ();
+        }
+    };
+
+}
+
+#endif
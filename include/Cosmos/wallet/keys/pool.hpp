@@ -0,0 +1,84 @@
+#ifndef COSMOS_WALLET_KEYS_POOL
+#define COSMOS_WALLET_KEYS_POOL
+
+#include <Cosmos/types.hpp>
+#include <Cosmos/options.hpp>
+#include <Cosmos/wallet/keys/pubkeys.hpp>
+#include <Cosmos/wallet/keys/redeemer.hpp>
+#include <unordered_map>
+#include <cstring>
+
+namespace Cosmos {
+
+    // a hash function for digests, which are already uniformly distributed.
+    struct digest_hash {
+        size_t operator () (const digest256 &d) const {
+            size_t h;
+            std::memcpy (&h, d.data (), sizeof (size_t));
+            return h;
+        }
+    };
+
+    // Pre-derived addresses for a set of address sequences with an index from
+    // the hashes of their P2PKH and P2PK scripts back to where they came from.
+    // Matching an output script against every watched address is a single lookup.
+    struct address_pool {
+
+        // where a script is found in the pool.
+        struct position {
+            string Sequence;
+            uint32 Index;
+            // whether the script is P2PK rather than P2PKH.
+            bool PayToPubkey;
+        };
+
+        // how many addresses past the end of a sequence are kept derived.
+        uint32 LookAhead;
+
+        explicit address_pool (uint32 look_ahead = options::DefaultMaxLookAhead) :
+            LookAhead {look_ahead}, Sequences {}, End {}, Index {} {}
+
+        // derive LookAhead addresses past the last used address of every sequence.
+        explicit address_pool (const addresses &, uint32 look_ahead = options::DefaultMaxLookAhead);
+
+        // catch up with sequences that have been used since the pool was made.
+        void extend (const addresses &);
+
+        // make sure that LookAhead addresses starting at index next are derived.
+        void extend (const string &name, const address_sequence &, uint32 next);
+
+        void extend (const string &name, const address_sequence &x) {
+            extend (name, x, x.Last);
+        }
+
+        const position *find (const digest256 &script_hash) const {
+            auto x = Index.find (script_hash);
+            return x == Index.end () ? nullptr : &x->second;
+        }
+
+        const position *find (const bytes &script) const {
+            return find (Gigamonkey::SHA2_256 (script));
+        }
+
+        // index of the next address that has not been derived in a sequence.
+        uint32 end (const string &name) const {
+            auto x = End.find (name);
+            return x == End.end () ? 0 : x->second;
+        }
+
+        // information required to redeem an output with the script at the given position.
+        signing signing_at (const position &) const;
+
+        size_t size () const {
+            return Index.size ();
+        }
+
+    private:
+        std::map<string, address_sequence> Sequences;
+        std::map<string, uint32> End;
+        std::unordered_map<digest256, position, digest_hash> Index;
+    };
+
+}
+
+#endif
@@ -6,6 +6,8 @@
 
 namespace Cosmos {
 
+    struct derivation_cache;
+
     struct keychain : base_map<pubkey, secret, keychain> {
         using base_map<pubkey, secret, keychain>::base_map;
 
@@ -13,6 +15,7 @@ namespace Cosmos {
         operator JSON () const;
 
         Bitcoin::secret derive (const derivation &) const;
+        Bitcoin::secret derive (const derivation &, derivation_cache &) const;
 
         using base_map<pubkey, secret, keychain>::insert;
 
@@ -26,6 +29,46 @@ namespace Cosmos {
         }
     };
 
+    // memoizes extended secret keys derived from a keychain so that keys
+    // which share a derivation path prefix only need one child derivation
+    // each after the first. All keys are zeroed when the cache is dropped.
+    struct derivation_cache {
+        derivation_cache () : Keys {} {}
+        ~derivation_cache ();
+
+        derivation_cache (const derivation_cache &) = delete;
+        derivation_cache &operator = (const derivation_cache &) = delete;
+
+        Bitcoin::secret derive (const keychain &, const derivation &);
+        HD::BIP_32::secret derive (const keychain &, const pubkey &parent, const HD::BIP_32::path &);
+
+        // number of calls to derive.
+        uint64 Lookups {0};
+        // number of calls to derive for which the complete path was cached.
+        uint64 Hits {0};
+        // number of child derivations performed.
+        uint64 Derivations {0};
+
+        double hit_rate () const {
+            return Lookups == 0 ? 0 : double (Hits) / double (Lookups);
+        }
+
+        size_t size () const {
+            return Keys.size ();
+        }
+
+        // zero and remove all cached keys.
+        void clear ();
+
+    private:
+        std::map<std::pair<pubkey, std::vector<uint32>>, HD::BIP_32::secret> Keys;
+    };
+
+    std::ostream inline &operator << (std::ostream &o, const derivation_cache &c) {
+        return o << "derivation cache {lookups: " << c.Lookups << ", hits: " << c.Hits <<
+            ", derivations: " << c.Derivations << ", size: " << c.size () << "}";
+    }
+
     keychain inline read_keychain_from_file (const std::string &filename) {
         return keychain (read_from_file (filename).Payload);
     }
@@ -33,6 +76,16 @@ namespace Cosmos {
     Bitcoin::secret inline keychain::derive (const derivation &d) const {
         return Bitcoin::secret (HD::BIP_32::secret {(*this)[d.Parent]}.derive (d.Path));
     }
+
+    Bitcoin::secret inline keychain::derive (const derivation &d, derivation_cache &c) const {
+        return c.derive (*this, d);
+    }
+
+    Bitcoin::secret inline derivation_cache::derive (const keychain &k, const derivation &d) {
+        HD::BIP_32::secret x = derive (k, d.Parent, d.Path);
+        if (!x.valid ()) return Bitcoin::secret {};
+        return Bitcoin::secret (x);
+    }
 }
 
 #endif
@@ -2,9 +2,11 @@
 #define COSMOS_WALLET_KEYS_SEQUENCE
 
 #include <Cosmos/wallet/keys/derivation.hpp>
+#include <gigamonkey/script/pattern/pay_to_address.hpp>
 
 namespace Cosmos {
     namespace HD = Gigamonkey::HD;
+    using pay_to_address = Gigamonkey::pay_to_address;
 
     // Like derivation, derived_pubkey includes a pubkey and a path.
     // However, address_sequence is guaranteed to include only a non-hardened
@@ -15,14 +17,27 @@ namespace Cosmos {
         // derivation from this pubkey to the address. Must be non-hardened
         HD::BIP_32::path Path;
 
+        // optional: the pubkey derived from Parent with all but the last
+        // element of Path. If provided, derive only needs one more step.
+        ptr<HD::BIP_32::pubkey> Node {nullptr};
+
         // the derived pubkey
-        HD::BIP_32::pubkey derive () const {
-            return Parent.derive (Path);
-        }
+        HD::BIP_32::pubkey derive () const;
 
         bool valid () const;
     };
 
+    // an address in a sequence along with its P2PKH script.
+    struct derived_address {
+        uint32 Index;
+        HD::BIP_32::pubkey Pubkey;
+        Bitcoin::address Address;
+        bytes Script;
+
+        derived_address () : Index {0}, Pubkey {}, Address {}, Script {} {}
+        derived_address (uint32 i, const HD::BIP_32::pubkey &pk);
+    };
+
     struct address_sequence {
         HD::BIP_32::pubkey Parent;
         // derivation from this pubkey to the address. Must be non-hardened
@@ -37,6 +52,17 @@ namespace Cosmos {
         derived_pubkey last () const;
         address_sequence next () const;
 
+        // the pubkey at Path, from which every address in the sequence is
+        // a single non-hardened derivation. It is derived the first time
+        // it is needed and is carried along by next and by copies.
+        // This writes to the sequence even though it is const, so an
+        // address_sequence is not thread-safe: call node () before the
+        // same sequence is used on several threads.
+        const HD::BIP_32::pubkey &node () const;
+
+        // derive count addresses starting with index first.
+        cross<derived_address> derive_range (uint32 first, uint32 count) const;
+
         address_sequence sub () const;
 
         explicit address_sequence (const JSON &);
@@ -49,6 +75,10 @@ namespace Cosmos {
         }
 
         bool operator == (const address_sequence &x) const;
+
+    private:
+        // written lazily by node (), which is not synchronized.
+        mutable ptr<HD::BIP_32::pubkey> Node {nullptr};
     };
 
     std::ostream inline &operator << (std::ostream &o, const address_sequence &a) {
@@ -56,7 +86,27 @@ namespace Cosmos {
     }
 
     address_sequence inline address_sequence::next () const {
-        return address_sequence {this->Parent, this->Path, Last + 1};
+        address_sequence x {this->Parent, this->Path, Last + 1};
+        x.Node = Node;
+        return x;
+    }
+
+    const inline HD::BIP_32::pubkey &address_sequence::node () const {
+        if (Node == nullptr) Node = std::make_shared<HD::BIP_32::pubkey> (Parent.derive (Path));
+        return *Node;
+    }
+
+    HD::BIP_32::pubkey inline derived_pubkey::derive () const {
+        if (Node == nullptr) return Parent.derive (Path);
+        uint32 last_index {0};
+        for (uint32 u : Path) last_index = u;
+        return Node->derive (HD::BIP_32::path {last_index});
+    }
+
+    inline derived_address::derived_address (uint32 i, const HD::BIP_32::pubkey &pk) : Index {i}, Pubkey {pk} {
+        auto decoded = Pubkey.address ();
+        Address = decoded.encode ();
+        Script = pay_to_address::script (decoded.Digest);
     }
 
     bool inline address_sequence::operator == (const address_sequence &x) const {
@@ -64,7 +114,8 @@ namespace Cosmos {
     }
 
     derived_pubkey inline address_sequence::last () const {
-        return {this->Parent, Path << Last};
+        node ();
+        return {this->Parent, Path << Last, Node};
     }
 }
 
@@ -5,6 +5,40 @@
 
 namespace Cosmos {
 
+    // the progress of restoring a wallet, which is saved so that
+    // an interrupted restore can continue where it left off.
+    struct restore_progress {
+        struct sequence {
+            // the first address that was checked.
+            uint32 First {0};
+            // every address before this one has been checked.
+            uint32 Checked {0};
+            // last key used (+1)
+            uint32 Last {0};
+            // the height of the chain when the sequence was last checked.
+            uint32 Height {0};
+            // whether the gap limit was reached.
+            bool Done {false};
+            // if only the unspent outputs were restored, the history is downloaded
+            // afterwards. Every address before Backfilled has its history.
+            uint32 Backfilled {0};
+            bool HistoryComplete {false};
+
+            sequence () {}
+            sequence (uint32 first, uint32 checked, uint32 last, uint32 height, bool done) :
+                First {first}, Checked {checked}, Last {last}, Height {height}, Done {done} {}
+
+            explicit sequence (const JSON &);
+            explicit operator JSON () const;
+        };
+
+        std::map<string, sequence> Sequences;
+
+        restore_progress () : Sequences {} {}
+        explicit restore_progress (const JSON &);
+        explicit operator JSON () const;
+    };
+
     struct restore {
         uint32 MaxLookAhead;
         // whether to check for derived addresses as well.
@@ -19,7 +53,52 @@ namespace Cosmos {
             uint32 Last;
         };
 
-        restored operator () (TXDB &, address_sequence pubkey);
+        // whatsonchain allows 3 requests per second, so we use 3
+        // threads which each make one request per second.
+        constexpr static uint32 DefaultThreads {3};
+
+        struct result {
+            map<string, restored> Restored;
+            restore_progress Progress;
+            // if the restore was interrupted, everything found before
+            // the error is still included and can be saved.
+            maybe<std::string> Error;
+        };
+
+        // restore many sequences at once, continuing from the given progress. Addresses
+        // are derived in windows of MaxLookAhead + 1 and their histories are downloaded
+        // on several threads while the previous window is imported. Each sequence stops
+        // on its own once it reaches MaxLookAhead + 1 unused addresses in a row.
+        result operator () (cached_remote_TXDB &, map<string, address_sequence>,
+            const restore_progress & = {}, uint32 threads = DefaultThreads) const;
+
+        // restore only what is needed to spend: the unspent outputs of every sequence
+        // and the txs that contain them, with their proofs. History is left empty and
+        // can be downloaded later with backfill.
+        result unspent (cached_remote_TXDB &, map<string, address_sequence>,
+            const restore_progress & = {}, uint32 threads = DefaultThreads) const;
+
+        // download the history of sequences that were restored with unspent, continuing
+        // from the given progress. Only History is filled in the result since the account
+        // is already complete. Txs that we already have are not downloaded again.
+        result backfill (cached_remote_TXDB &, map<string, address_sequence>,
+            const restore_progress &, uint32 threads = DefaultThreads) const;
+
+        // check sequences that have already been restored for txs since the
+        // height at which they were last checked.
+        result rescan (cached_remote_TXDB &, map<string, address_sequence>,
+            const restore_progress &, uint32 threads = DefaultThreads) const;
+
+    private:
+        enum class mode {
+            history,
+            unspent,
+            rescan,
+            backfill
+        };
+
+        result scan (cached_remote_TXDB &, map<string, address_sequence>,
+            const restore_progress &, uint32 threads, mode) const;
 
     };
 
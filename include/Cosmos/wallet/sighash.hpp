@@ -0,0 +1,45 @@
+#ifndef COSMOS_WALLET_SIGHASH
+#define COSMOS_WALLET_SIGHASH
+
+#include <Cosmos/types.hpp>
+#include <vector>
+
+namespace Cosmos {
+
+    // The parts of the forkid (BIP 143) signature hash preimage that are shared
+    // by every input of a transaction. hashPrevouts, hashSequence and hashOutputs
+    // are computed once so that the cost of each signature does not depend on
+    // the size of the transaction.
+    struct sighash_context {
+        int32_little Version;
+        uint32_little LockTime;
+
+        std::vector<Bitcoin::outpoint> Outpoints;
+        std::vector<uint32_little> Sequences;
+        std::vector<Bitcoin::output> Outputs;
+
+        digest256 HashPrevouts;
+        digest256 HashSequence;
+        digest256 HashOutputs;
+
+        explicit sighash_context (const Bitcoin::incomplete::transaction &);
+
+        // the preimage for the given input, which redeems an output with the given value.
+        // bench/sighash.cpp checks that this agrees with Bitcoin::sighash::write.
+        bytes preimage (Bitcoin::index input, Bitcoin::satoshi value,
+            const bytes &script_code, Bitcoin::sighash::directive) const;
+
+        // the digest that is signed.
+        digest256 digest (Bitcoin::index input, Bitcoin::satoshi value,
+            const bytes &script_code, Bitcoin::sighash::directive d) const {
+            return Gigamonkey::Hash256 (preimage (input, value, script_code, d));
+        }
+
+        // sign the given input. We only handle forkid signatures.
+        Bitcoin::signature sign (const Bitcoin::secret &, Bitcoin::index input, Bitcoin::satoshi value,
+            const bytes &script_code, Bitcoin::sighash::directive) const;
+    };
+
+}
+
+#endif
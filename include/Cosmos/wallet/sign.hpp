@@ -0,0 +1,71 @@
+#ifndef COSMOS_WALLET_SIGN
+#define COSMOS_WALLET_SIGN
+
+#include <Cosmos/types.hpp>
+#include <Cosmos/parallel.hpp>
+#include <Cosmos/wallet/sighash.hpp>
+#include <gigamonkey/redeem.hpp>
+
+namespace Cosmos {
+
+    using redeem = Gigamonkey::redeem;
+    using extended_transaction = Gigamonkey::extended::transaction;
+
+    // an input together with the keys required to sign it.
+    struct signer {
+        list<Bitcoin::secret> Keys;
+        Bitcoin::prevout Prevout;
+        uint64 ExpectedScriptSize;
+        uint32_little Sequence;
+        bytes UnlockScriptSoFar;
+
+        // SIGHASH_ALL | SIGHASH_FORKID.
+        constexpr static byte DefaultDirective {0x41};
+
+        signer (list<Bitcoin::secret> k, const Bitcoin::prevout &p, uint64 ez,
+            uint32_little seq = Bitcoin::input::Finalized, const bytes &so_far = {}) :
+            Keys {k}, Prevout {p}, ExpectedScriptSize {ez}, Sequence {seq}, UnlockScriptSoFar {so_far} {}
+
+        list<Gigamonkey::sigop> sigops () const {
+            return for_each ([] (const Bitcoin::secret &k) -> Gigamonkey::sigop {
+                return Gigamonkey::sigop {k};
+            }, Keys);
+        }
+
+        explicit operator Gigamonkey::redeemer () const {
+            return Gigamonkey::redeemer {sigops (), Prevout, ExpectedScriptSize, Sequence, UnlockScriptSoFar};
+        }
+
+        // if this is a single-key P2PKH or P2PK input, sign it using the
+        // shared sighash context. Otherwise return nothing. This is what
+        // redeem_p2pkh_and_p2pk would do, so it should only be used in its place.
+        maybe<bytes> sign (const sighash_context &, Bitcoin::index) const;
+    };
+
+    // a transaction whose inputs can be signed independently of one another.
+    struct signable_transaction {
+        int32_little Version;
+        std::vector<signer> Inputs;
+        list<Bitcoin::output> Outputs;
+        uint32_little LockTime;
+
+        signable_transaction (int32_little v, std::vector<signer> i, list<Bitcoin::output> o, uint32_little l = 0) :
+            Version {v}, Inputs {i}, Outputs {o}, LockTime {l} {}
+
+        // use this to estimate sizes and fees before signing.
+        Gigamonkey::redeemable_transaction design () const;
+
+        Bitcoin::incomplete::transaction incomplete () const;
+
+        // sign every input. Inputs are divided among up to the given number of
+        // threads and the result is the same for any number of threads. If the
+        // redeem function is Gigamonkey::redeem_p2pkh_and_p2pk, P2PKH and P2PK
+        // inputs are signed with a shared sighash_context instead; otherwise it
+        // is used for every input. It must be safe to call from several threads
+        // at once, which is true of the standard ones since they have no state.
+        extended_transaction sign (redeem, uint32 threads = default_threads ()) const;
+    };
+
+}
+
+#endif
@@ -4,7 +4,8 @@
 #include <gigamonkey/timechain.hpp>
 #include <data/crypto/random.hpp>
 #include <Cosmos/wallet/wallet.hpp>
-#include <data/math/probability/triangular_distribution.hpp>
+#include <random>
+#include <mutex>
 #include <Cosmos/options.hpp>
 
 namespace Cosmos {
@@ -28,12 +29,6 @@ namespace Cosmos {
             list<entry<Bitcoin::outpoint, redeemable>> selected,
             double fee_rate) const;
 
-        // produce an unsigned transaction that can be signed later.
-        spend::spent_unsigned operator () (
-            redeem, data::crypto::random &, wallet,
-            list<entry<Bitcoin::outpoint, redeemable>> selected,
-            double fee_rate) const;
-
         struct result {
             list<std::pair<extended_transaction, account_diff>> Transactions;
             uint32 Last;
@@ -53,14 +48,40 @@ namespace Cosmos {
         result_outputs operator () (data::crypto::random &r, address_sequence key,
             Bitcoin::satoshi value, double fee_rate) const;
 
+        // construct only the values of the outputs. The given value pays for the outputs
+        // themselves but not for anything else in the tx. Return nothing if more than
+        // max_outputs outputs would be required.
+        maybe<std::vector<Bitcoin::satoshi>> values (data::crypto::random &r,
+            Bitcoin::satoshi value, double fee_rate,
+            uint32 max_outputs = std::numeric_limits<uint32>::max ()) const;
+
+        // a distribution whose logarithm has a triangular distribution.
         struct log_triangular_distribution {
-            math::triangular_distribution<double> Triangular;
+            // parameters of the triangular distribution in log space.
+            double A;
+            double Mode;
+            double B;
 
             log_triangular_distribution (double min, double max, double mean);
 
+            // finding the mode is expensive, so distributions are cached by their parameters.
+            static const log_triangular_distribution &get (double min, double max, double mean);
+
+            // u must be in [0, 1].
+            double inverse_cdf (double u) const;
+
             template <std::uniform_random_bit_generator engine>
             double operator () (engine &e) const;
 
+            // generate many values at once.
+            template <std::uniform_random_bit_generator engine>
+            void generate (engine &e, std::vector<double> &values, size_t count) const;
+
+        private:
+            // precomputed for the inverse cdf.
+            double ModeCDF;
+            double Left;
+            double Right;
         };
 
         log_triangular_distribution LogTriangular;
@@ -101,9 +122,23 @@ namespace Cosmos {
         return spend::spent {rr.Transactions, w.Addresses.update (w.Addresses.Change, rr.Last)};
     }
 
+    double inline split::log_triangular_distribution::inverse_cdf (double u) const {
+        return exp (u < ModeCDF ? A + std::sqrt (u * Left) : B - std::sqrt ((1 - u) * Right));
+    }
+
     template <std::uniform_random_bit_generator engine>
     double inline split::log_triangular_distribution::operator () (engine &e) const {
-        return exp (Triangular (e));
+        return inverse_cdf (std::uniform_real_distribution<double> {0, 1} (e));
+    }
+
+    template <std::uniform_random_bit_generator engine>
+    void split::log_triangular_distribution::generate (engine &e, std::vector<double> &values, size_t count) const {
+        std::uniform_real_distribution<double> uniform {0, 1};
+        size_t begin = values.size ();
+        values.resize (begin + count);
+        for (size_t i = begin; i < values.size (); i++) values[i] = uniform (e);
+        // no dependencies between iterations, so this loop can be vectorized.
+        for (size_t i = begin; i < values.size (); i++) values[i] = inverse_cdf (values[i]);
     }
 
     inline split::split (
@@ -113,10 +148,10 @@ namespace Cosmos {
         MinSatsPerOutput {min_sats_per_output},
         MaxSatsPerOutput {max_sats_per_output},
         MeanSatsPerOutput {mean_sats_per_output},
-        LogTriangular {
+        LogTriangular {log_triangular_distribution::get (
             static_cast<double> (min_sats_per_output),
             static_cast<double> (max_sats_per_output),
-            mean_sats_per_output} {}
+            mean_sats_per_output)} {}
 }
 
 #endif
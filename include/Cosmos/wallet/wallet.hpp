@@ -7,27 +7,39 @@
 #include <Cosmos/wallet/keys/secret.hpp>
 #include <Cosmos/wallet/select.hpp>
 #include <Cosmos/wallet/change.hpp>
-#include <gigamonkey/redeem.hpp>
+#include <Cosmos/wallet/sign.hpp>
+#include <Cosmos/wallet/estimate.hpp>
 #include <chrono>
 
 namespace Cosmos {
 
-    using redeem = Gigamonkey::redeem;
-    using extended_transaction = Gigamonkey::extended::transaction;
-
     // can't use namespace unsigend since 'unsigned' is a reserved word.
     // nosig is for transactions that can have their signatures inserted later.
+    // They can be constructed on a watch-only host and signed somewhere else.
     namespace nosig {
         struct sigop {
             Bitcoin::sighash::directive Directive;
             derivation Derivation;
+
+            sigop (const derivation &d, Bitcoin::sighash::directive x = signer::DefaultDirective) :
+                Directive {x}, Derivation {d} {}
+
+            explicit sigop (const JSON &);
+            explicit operator JSON () const;
         };
 
+        // an input script with spaces left for signatures.
         using script = list<either<bytes, sigop>>;
 
         struct input : Bitcoin::incomplete::input {
             script Script;
             Bitcoin::output Prevout;
+
+            input (const Bitcoin::prevout &p, const script &x, uint32_little sequence = Bitcoin::input::Finalized) :
+                Bitcoin::incomplete::input {p.Key, sequence}, Script {x}, Prevout {p.Value} {}
+
+            explicit input (const JSON &);
+            explicit operator JSON () const;
         };
 
         struct transaction {
@@ -37,18 +49,31 @@ namespace Cosmos {
             list<Bitcoin::output> Outputs;
             uint32_little LockTime;
 
-            transaction sign (const keychain &k) const;
+            transaction (int32_little v, list<input> i, list<Bitcoin::output> o, uint32_little l = 0) :
+                Version {v}, Inputs {i}, Outputs {o}, LockTime {l} {}
+
+            Bitcoin::incomplete::transaction incomplete () const;
+
+            // keys are found through the cache, so when a batch of transactions
+            // from the same wallet is signed, each key is only derived once.
+            extended_transaction sign (const keychain &, const pubkeys &, derivation_cache &,
+                uint32 threads = default_threads ()) const;
+
+            extended_transaction sign (const keychain &k, const pubkeys &p) const {
+                derivation_cache keys {};
+                return sign (k, p, keys);
+            }
 
             explicit transaction (const JSON &);
             explicit operator JSON () const;
 
         };
 
-        using write_scripts = function<script (pubkeys &, const Bitcoin::output &, const Bitcoin::sighash::document &,
-            list<Bitcoin::sighash::directive>, const bytes &script_code)>;
+        // write a script with spaces for signatures that redeems the given output.
+        using write_scripts = function<script (const redeemable &)>;
 
-        script p2pkh_and_p2pk (pubkeys &, const Bitcoin::output &, const Bitcoin::sighash::document &,
-            list<Bitcoin::sighash::directive>, const bytes &script_code);
+        // redeem P2PKH and P2PK outputs.
+        script p2pkh_and_p2pk (const redeemable &);
 
     }
 
@@ -71,6 +96,9 @@ namespace Cosmos {
 
     Bitcoin::secret find_secret (keychain k, pubkeys p, derivation d);
 
+    // use a cache if we need to find many keys with similar derivations.
+    Bitcoin::secret find_secret (const keychain &k, const pubkeys &p, derivation d, derivation_cache &);
+
     struct spend {
         select Select;
         make_change Change;
@@ -100,18 +128,23 @@ namespace Cosmos {
             // that field in account_diff will be zero.
             list<std::pair<nosig::transaction, account_diff>> Transactions;
             pubkeys Pubkeys;
+            addresses Addresses;
 
             bool valid () const {
                 return data::size (Transactions) != 0;
             }
 
-            spent_unsigned () : Transactions {}, Pubkeys {} {}
+            spent_unsigned () : Transactions {}, Pubkeys {}, Addresses {} {}
+            spent_unsigned (list<std::pair<nosig::transaction, account_diff>> txs, const pubkeys &p, const addresses &a) :
+                Transactions {txs}, Pubkeys {p}, Addresses {a} {}
 
+            // sign all transactions and fill in their txids.
             spent sign (const keychain &) const;
         };
 
+        // like the function above but no keys are required.
         spent_unsigned operator () (nosig::write_scripts,
-            const pubkeys &, const account &,
+            wallet,
             list<Bitcoin::output> to,
             satoshis_per_byte fees = {1, 100},
             uint32 lock = 0) const;
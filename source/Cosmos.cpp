@@ -1,5 +1,6 @@
 
 #include <regex>
+#include <fstream>
 
 #include <data/io/exception.hpp>
 #include <data/crypto/NIST_DRBG.hpp>
@@ -110,6 +111,11 @@ error run (const io::arg_parser &p) {
                     break;
                 }
 
+                case method::CONSOLIDATE: {
+                    command_consolidate (p);
+                    break;
+                }
+
                 case method::BOOST: {
                     command_boost (p);
                     break;
@@ -120,6 +126,16 @@ error run (const io::arg_parser &p) {
                     break;
                 }
 
+                case method::EXPORT: {
+                    command_export (p);
+                    break;
+                }
+
+                case method::DAEMON: {
+                    command_daemon (p);
+                    break;
+                }
+
                 default: {
                     std::cout << "Error: could not read user's command." << std::endl;
                     help ();
@@ -177,7 +193,10 @@ method read_method (const arg_parser &p, uint32 index) {
     if (*m == "send") return method::SEND;
     if (*m == "boost") return method::BOOST;
     if (*m == "split") return method::SPLIT;
+    if (*m == "consolidate") return method::CONSOLIDATE;
     if (*m == "taxes") return method::TAXES;
+    if (*m == "export") return method::EXPORT;
+    if (*m == "daemon") return method::DAEMON;
 
     return method::UNSET;
 }
@@ -198,7 +217,10 @@ void help (method meth) {
                 "\n\tsend       -- send to an address or script. (depricated)"
                 "\n\tboost      -- boost content."
                 "\n\tsplit      -- split an output into many pieces"
+                "\n\tconsolidate -- merge many small outputs into fewer pieces"
                 "\n\trestore    -- restore a wallet from words, a key, or many other options."
+                "\n\texport     -- write history or tax data to a csv or ndjson file."
+                "\n\tdaemon     -- keep the wallet loaded and serve commands as JSON-RPC over a unix socket."
                 "\nuse help \"method\" for information on a specific method"<< std::endl;
         } break;
         case method::GENERATE : {
@@ -234,6 +256,9 @@ void help (method meth) {
                 "\n\t(--amount=<amount to pay>)"
                 "\n\t(--memo=<what is the payment about>)"
                 "\n\t(--output=<output in hex>)"
+                "\n\t(--batch=<file with one payment request or address and amount per line>)"
+                "\n\t(--unsigned=<file to write unsigned transactions to for the sign command>)"
+                "\n\t(--signed=<file of transactions from the sign command to complete an unsigned payment>)"
                 "\n\t(--min_sats_per_output=<float>) (= " << Cosmos::options::DefaultMinSatsPerOutput << ")"
                 "\n\t(--max_sats_per_output=<float>) (= " << Cosmos::options::DefaultMaxSatsPerOutput << ")"
                 "\n\t(--mean_sats_per_output=<float>) (= " << Cosmos::options::DefaultMeanSatsPerOutput << ") "  << std::endl;
@@ -244,7 +269,11 @@ void help (method meth) {
                 "\n\t(--payment=)<payment tx in BEEF or SPV envelope>"<< std::endl;
         } break;
         case method::SIGN : {
-            std::cout << "arguments for method sign not yet available." << std::endl;
+            std::cout << "Sign a file of unsigned transactions, one JSON object per line."
+                "\narguments for method sign:"
+                "\n\t(--name=)<wallet name>"
+                "\n\t(--input=)<file of unsigned transactions>"
+                "\n\t(--output=<file to write signed transactions in hex>) (= stdout)" << std::endl;
         } break;
         case method::IMPORT : {
             std::cout << "arguments for method import not yet available." << std::endl;
@@ -263,8 +292,48 @@ void help (method meth) {
                 "\n\t(--max_look_ahead=)<integer> (= 10) ; (only used if parameter 'address' is provided as an xpub"
                 "\n\t(--min_sats_per_output=<float>) (= " << Cosmos::options::DefaultMinSatsPerOutput << ")"
                 "\n\t(--max_sats_per_output=<float>) (= " << Cosmos::options::DefaultMaxSatsPerOutput << ")"
+                "\n\t(--mean_sats_per_output=<float>) (= " << Cosmos::options::DefaultMeanSatsPerOutput << ") "
+                "\n\t(--max_outputs_per_tx=<integer>) (= " << Cosmos::options::DefaultMaxOutputsPerTx << ")"
+                "\n\t(--max_tx_size=<integer>) (= " << Cosmos::options::DefaultMaxTxSize << ") " << std::endl;
+        } break;
+        case method::EXPORT : {
+            std::cout << "Write history or tax data to a file one row at a time."
+                "\narguments for method export:"
+                "\n\t(--name=)<wallet name>"
+                "\n\t(--what=)\"history\"|\"taxes\""
+                "\n\t(--output=)<filename>"
+                "\n\t(--format=\"csv\"|\"ndjson\") (= \"csv\")"
+                "\n\t(--year=<integer>)"
+                "\n\t(--from=<unix time>)"
+                "\n\t(--to=<unix time>)" << std::endl;
+        } break;
+        case method::DAEMON : {
+            std::cout << "Keep the wallet in memory and serve commands as JSON-RPC 2.0 over a unix socket, one request per line. "
+                "Changes are written to disk in the background."
+                "\nmethods are value, update, request, pay, accept, flush, and stop, with the same parameters as the "
+                "corresponding commands given as a JSON object."
+                "\narguments for method daemon:"
+                "\n\t(--name=)<wallet name>"
+                "\n\t(--socket=<filename>) (= <wallet name>.sock)"
+                "\n\t(--flush_interval=<seconds>) (= 5)"
+                "\n\t(--fee_rate=<float>)"
+                "\n\t(--min_sats_per_output=<float>) (= " << Cosmos::options::DefaultMinSatsPerOutput << ")"
+                "\n\t(--max_sats_per_output=<float>) (= " << Cosmos::options::DefaultMaxSatsPerOutput << ")"
                 "\n\t(--mean_sats_per_output=<float>) (= " << Cosmos::options::DefaultMeanSatsPerOutput << ") " << std::endl;
         } break;
+        case method::CONSOLIDATE : {
+            std::cout << "Merge outputs in your wallet below a threshold into fewer outputs, along with any other outputs with the same script. "
+                "\narguments for method consolidate:"
+                "\n\t(--name=)<wallet name>"
+                "\n\t(--threshold=)<float> (= min_sats_per_output)"
+                "\n\t(--max_fee_rate=<float>) ; (do nothing if the network fee rate in sats per byte is higher)"
+                "\n\t(--fee_rate=<float>)"
+                "\n\t(--min_sats_per_output=<float>) (= " << Cosmos::options::DefaultMinSatsPerOutput << ")"
+                "\n\t(--max_sats_per_output=<float>) (= " << Cosmos::options::DefaultMaxSatsPerOutput << ")"
+                "\n\t(--mean_sats_per_output=<float>) (= " << Cosmos::options::DefaultMeanSatsPerOutput << ") "
+                "\n\t(--max_outputs_per_tx=<integer>) (= " << Cosmos::options::DefaultMaxOutputsPerTx << ")"
+                "\n\t(--max_tx_size=<integer>) (= " << Cosmos::options::DefaultMaxTxSize << ") " << std::endl;
+        } break;
         case method::RESTORE : {
             std::cout << "arguments for method restore:"
                 "\n\t(--name=)<wallet name>"
@@ -274,7 +343,11 @@ void help (method meth) {
                 "\n\t(--key_type=\"HD_sequence\"|\"BIP44_account\"|\"BIP44_master\") (= \"HD_sequence\")"
                 "\n\t(--coin_type=\"Bitcoin\"|\"BitcoinCash\"|\"BitcoinSV\"|<integer>)"
                 "\n\t(--wallet_type=\"RelayX\"|\"ElectrumSV\"|\"SimplyCash\"|\"CentBee\"|<string>)"
-                "\n\t(--entropy=<string>)" << std::endl;
+                "\n\t(--entropy=<string>)"
+                "\n\t(--utxo_first) (restore unspent outputs only so the wallet can be used before its history is downloaded)"
+                "\n\t(--backfill) (download the history of a wallet restored with --utxo_first)"
+                "\n\tprogress is saved in <wallet name>.restore.json; if a restore is interrupted, run it again to continue."
+                "\n\tupdate --rescan checks restored address sequences for new transactions since the last check." << std::endl;
         }
     }
 
@@ -296,8 +369,16 @@ void command_value (const arg_parser &p) {
 // find all pending transactions and check if merkle proofs are available.
 void command_update (const arg_parser &p) {
     Cosmos::Interface e {};
-    Cosmos::read_account_and_txdb_options (e, p);
-    e.update<void> (Cosmos::update_pending_transactions);
+
+    // looking for new txs in restored sequences takes a request per address, so it is optional.
+    bool rescan = p.has ("rescan");
+    if (rescan) Cosmos::read_watch_wallet_options (e, p);
+    else Cosmos::read_account_and_txdb_options (e, p);
+
+    e.update<void> ([rescan] (Cosmos::Interface::writable u) {
+        Cosmos::update_pending_transactions (u);
+        if (rescan) Cosmos::update_restored_sequences (u);
+    });
 }
 
 maybe<std::string> de_escape (string_view input) {
@@ -319,14 +400,279 @@ maybe<std::string> de_escape (string_view input) {
     return {decoded.str ()};
 }
 
+// the output that pays a payment request.
+Bitcoin::output payment_output (const Cosmos::payments::payment_request &pr) {
+    using namespace Cosmos;
+    if (!bool (pr.Value.Amount)) throw exception {} << "no amount provided for " << pr.Key;
+
+    Bitcoin::address addr {pr.Key};
+    Bitcoin::pubkey pubkey {pr.Key};
+    HD::BIP_32::pubkey xpub {pr.Key};
+
+    if (addr.valid ()) return Bitcoin::output {*pr.Value.Amount, pay_to_address::script (addr.digest ())};
+    if (pubkey.valid ()) return Bitcoin::output {*pr.Value.Amount, pay_to_pubkey::script (pubkey)};
+    if (xpub.valid ()) throw exception {} << "pay to xpub not yet implemented";
+    throw exception {} << "could not read payment address " << pr.Key;
+}
+
+// a line of a batch payment file is either a payment request
+// in JSON or an address and an amount followed by an optional memo.
+Cosmos::payments::payment_request read_batch_line (const std::string &line) {
+    using namespace Cosmos;
+    if (line[0] == '{') {
+        payments::payment_request pr = payments::read_payment_request (JSON::parse (line));
+        if (!bool (pr.Value.Amount)) throw exception {} << "no amount provided in payment request " << line;
+        return pr;
+    }
+
+    std::stringstream ss {line};
+    std::string address;
+    int64 amount;
+    if (!(ss >> address >> amount)) throw exception {} << "could not read batch payment line " << line;
+
+    payments::payment_request pr {address, payments::request {}};
+    pr.Value.Amount = Bitcoin::satoshi {amount};
+
+    std::string memo;
+    std::getline (ss >> std::ws, memo);
+    if (memo.size () > 0) pr.Value.Memo = memo;
+
+    return pr;
+}
+
+// pay many payment requests with a single tx.
+void command_pay_batch (Cosmos::Interface &e, const arg_parser &p, const std::string &filename, const maybe<std::string> &output) {
+    using namespace Cosmos;
+
+    std::ifstream in {filename};
+    if (!in) throw exception {2} << "could not open batch file " << filename;
+
+    list<payments::payment_request> requests;
+    set<std::string> payees;
+    Bitcoin::satoshi total {0};
+    std::string line;
+    while (std::getline (in, line)) {
+        if (line.size () == 0) continue;
+        payments::payment_request pr = read_batch_line (line);
+        if (payees.contains (pr.Key)) throw exception {} << "payee " << pr.Key << " appears more than once in batch";
+        payees = payees.insert (pr.Key);
+        total += *pr.Value.Amount;
+        requests <<= pr;
+    }
+
+    if (data::size (requests) == 0) throw exception {2} << "no payments found in " << filename;
+
+    maybe<wallet> w = e.wallet ();
+    if (!bool (w)) throw exception {} << "could not load wallet";
+    Bitcoin::satoshi wallet_value = w->value ();
+
+    std::cout << "This is a batch of " << requests.size () << " payments for " << total << " sats; wallet value: " << wallet_value << std::endl;
+
+    if (wallet_value < total) throw exception {} << "Wallet does not have sufficient funds to make these payments";
+
+    options opts = read_tx_options (e, p);
+    e.update<void> (update_pending_transactions);
+
+    BEEF beef = e.update<BEEF> ([&requests, &opts] (Interface::writable u) -> BEEF {
+
+        // all payments go into the same tx, so they share inputs and change.
+        spend::spent spent = u.make_tx (for_each (payment_output, requests), opts);
+
+        std::cout << " generating SPV proof " << std::endl;
+        maybe<SPV::proof> ppp = generate_proof (*u.local_txdb (),
+            for_each ([] (const auto &e) -> Bitcoin::transaction {
+                return Bitcoin::transaction (e.first);
+            }, spent.Transactions));
+
+        if (!bool (ppp)) throw exception {} << "failed to generate payment";
+
+        BEEF beef {*ppp};
+        std::cout << "Beef produced containing " << beef.Transactions.size () <<
+            " transactions and " << beef.BUMPs.size () << " proofs" << std::endl;
+
+        list<account_diff> diff = for_each ([] (const auto &e) -> account_diff {
+            return e.second;
+        }, spent.Transactions);
+
+        // every request gets its own proposal, all containing the same diffs.
+        auto payments = *u.get ().payments ();
+        auto proposals = payments.Proposals;
+        for (const payments::payment_request &pr : requests)
+            proposals = proposals.insert (pr.Key, payments::offer {pr, beef, diff});
+        u.set_payments (Cosmos::payments {payments.Requests, proposals, payments.Unsigned});
+
+        return beef;
+    });
+
+    // every recipient receives the same BEEF since they are all paid by the same tx.
+    std::string offer = encoding::base64::write (bytes (beef));
+    if (bool (output)) {
+        uint32 index = 0;
+        for (const payments::payment_request &pr : requests) {
+            std::string filename = *output + "." + std::to_string (index++);
+            write_to_file (offer, filename);
+            std::cout << "offer for " << pr.Key << " written to " << filename << std::endl;
+        }
+    } else {
+        std::cout << "please show this string to each of your sellers and they will broadcast the payment if they accept it:\n\t" <<
+            offer << std::endl;
+        for (const payments::payment_request &pr : requests) std::cout << "\t" << pr.Key << std::endl;
+    }
+}
+
+namespace Cosmos {
+    namespace {
+        // put the txs of a payment into a BEEF and save it as a proposal.
+        BEEF make_offer (Interface::writable u, const payments::payment_request &pr,
+            list<std::pair<Bitcoin::transaction, account_diff>> txs) {
+            std::cout << " generating SPV proof " << std::endl;
+            maybe<SPV::proof> ppp = generate_proof (*u.local_txdb (),
+                for_each ([] (const auto &e) -> Bitcoin::transaction {
+                    return e.first;
+                }, txs));
+
+            if (!bool (ppp)) throw exception {} << "failed to generate payment";
+
+            std::cout << "SPV proof generated containing " << ppp->Payment.size () <<
+                " transactions and " << ppp->Proof.size () << " antecedents" << std::endl;
+
+            BEEF beef {*ppp};
+            std::cout << "Beef produced containing " << beef.Transactions.size () <<
+                " transactions and " << beef.BUMPs.size () << " proofs" << std::endl;
+
+            if (u.net ()->Interactive) wait_for_enter ("Press enter to continue.");
+
+            // save to proposed payments. If the txs were signed somewhere
+            // else, the payment is no longer waiting for them.
+            auto payments = *u.get ().payments ();
+            u.set_payments (Cosmos::payments {payments.Requests, payments.Proposals.insert (pr.Key, payments::offer
+                {pr, beef, for_each ([] (const auto &e) -> account_diff {
+                    return e.second;
+                }, txs)}),
+                bool (payments.Unsigned.contains (pr.Key)) ? payments.Unsigned.remove (pr.Key) : payments.Unsigned});
+
+            return beef;
+        }
+    }
+
+    // TODO encrypt payment request in OP_RETURN.
+    BEEF make_payment (Interface::writable u, const payments::payment_request &pr, const options &opts) {
+        spend::spent spent = u.make_tx ({payment_output (pr)}, opts);
+        return make_offer (u, pr, for_each ([] (const auto &e) -> std::pair<Bitcoin::transaction, account_diff> {
+            return {Bitcoin::transaction (e.first), e.second};
+        }, spent.Transactions));
+    }
+}
+
+void show_offer (const Cosmos::BEEF &beef, const maybe<std::string> &output) {
+    using namespace Cosmos;
+    if (bool (output)) {
+        // TODO make sure that the output doesn't already exist.
+        write_to_file (encoding::base64::write (bytes (beef)), *output);
+        std::cout << "offer written to " << *output << std::endl;
+    } else std::cout << "please show this string to your seller and he will broadcast the payment if he accepts it:\n\t" <<
+        encoding::base64::write (bytes (beef)) << std::endl;
+}
+
+// whether tx spends the outputs that diff removes from the account.
+bool spends (const Bitcoin::transaction &tx, const Cosmos::account_diff &diff) {
+    std::vector<Bitcoin::outpoint> inputs;
+    for (const Bitcoin::input &in : tx.Inputs) inputs.push_back (in.Reference);
+    if (inputs.size () != diff.Remove.size ()) return false;
+    for (const auto &[index, op] : diff.Remove)
+        if (index >= inputs.size () || inputs[index] != op) return false;
+    return true;
+}
+
+// read txs that were written with pay --unsigned and then signed with sign,
+// one in hex per line. The payment that they belong to becomes an offer.
+void command_pay_signed (Cosmos::Interface &e, const std::string &filename, const maybe<std::string> &output) {
+    using namespace Cosmos;
+
+    std::ifstream in {filename};
+    if (!in) throw exception {2} << "could not open file " << filename;
+
+    std::vector<Bitcoin::transaction> txs;
+    std::string line;
+    while (std::getline (in, line)) {
+        if (line.empty ()) continue;
+        maybe<bytes> tx = encoding::hex::read (line);
+        if (!bool (tx)) throw exception {2} << "could not read signed tx on line " << (txs.size () + 1);
+        txs.push_back (Bitcoin::transaction {*tx});
+    }
+
+    if (txs.size () == 0) throw exception {2} << "no transactions found in " << filename;
+
+    BEEF beef = e.update<BEEF> ([&txs, &filename] (Interface::writable u) -> BEEF {
+        const auto *pay = u.get ().payments ();
+        auto w = u.get ().wallet ();
+        if (!bool (pay) || !bool (w)) throw exception {} << "could not load wallet";
+
+        // sign keeps the txs in the order in which pay wrote them.
+        for (const auto &[id, offer] : pay->Unsigned) {
+            if (offer.Diff.size () != txs.size ()) continue;
+
+            list<std::pair<Bitcoin::transaction, account_diff>> complete;
+            size_t i = 0;
+            for (const account_diff &diff : offer.Diff) {
+                const Bitcoin::transaction &tx = txs[i++];
+                if (!spends (tx, diff)) break;
+
+                // make sure the signatures are good before we give this to anyone.
+                list<Gigamonkey::extended::input> inputs;
+                for (const Bitcoin::input &in : tx.Inputs) {
+                    const redeemable *re = w->Account.contains (in.Reference);
+                    if (!bool (re)) throw exception {} << "output " << in.Reference << " is not in the wallet";
+                    inputs <<= Gigamonkey::extended::input {re->Prevout, in};
+                }
+
+                if (!extended_transaction {tx.Version, inputs, tx.Outputs, tx.LockTime}.valid ())
+                    throw exception {3} << "signed tx " << tx.id () << " is not valid";
+
+                complete <<= {tx, account_diff {tx.id (), diff.Insert, diff.Remove}};
+            }
+
+            if (complete.size () == txs.size ()) return make_offer (u, offer.Request, complete);
+        }
+
+        throw exception {} << "no unsigned payment was found for the txs in " << filename;
+    });
+
+    show_offer (beef, output);
+}
+
 // TODO get fee rate from network.
 // TODO make sure we don't invalidate existing payments.
 void command_pay (const arg_parser &p) {
     using namespace Cosmos;
     Interface e {};
-    read_wallet_options (e, p);
+
+    // write the tx unsigned so that it can be signed with the sign
+    // command somewhere else. The private keys are not needed for this.
+    maybe<std::string> unsigned_file;
+    p.get ("unsigned", unsigned_file);
+
+    // txs that were written with --unsigned and have since been signed.
+    maybe<std::string> signed_file;
+    p.get ("signed", signed_file);
+
+    if (bool (unsigned_file) || bool (signed_file)) read_watch_wallet_options (e, p);
+    else read_wallet_options (e, p);
     read_random_options (p);
 
+    maybe<string> output;
+    p.get ("output", output);
+
+    if (bool (signed_file)) return command_pay_signed (e, *signed_file, output);
+
+    // a file of many payments to be made at once.
+    maybe<std::string> batch_file;
+    p.get ("batch", batch_file);
+    if (bool (batch_file)) {
+        if (bool (unsigned_file)) throw exception {2} << "--unsigned cannot be used with --batch";
+        return command_pay_batch (e, p, *batch_file, output);
+    }
+
     // first look for a payment request.
     maybe<std::string> payment_request_string;
     p.get (3, "request", payment_request_string);
@@ -342,9 +688,6 @@ void command_pay (const arg_parser &p) {
     maybe<string> memo_input;
     p.get ("memo", memo_input);
 
-    maybe<string> output;
-    p.get ("output", output);
-
     payments::payment_request *pr;
     if (bool (payment_request_string)) {
 
@@ -377,7 +720,9 @@ void command_pay (const arg_parser &p) {
 
     // TODO if other incomplete payments exist, be sure to subtract
     // them from the account so as not to create a double spend.
-    Bitcoin::satoshi wallet_value = e.wallet ()->value ();
+    maybe<wallet> w = e.wallet ();
+    if (!bool (w)) throw exception {} << "could not load wallet";
+    Bitcoin::satoshi wallet_value = w->value ();
 
     std::cout << "This is a payment for " << *pr->Value.Amount << " sats; wallet value: " << wallet_value << std::endl;
 
@@ -387,60 +732,101 @@ void command_pay (const arg_parser &p) {
     options opts = read_tx_options (e, p);
     e.update<void> (update_pending_transactions);
 
-    // TODO encrypt payment request in OP_RETURN.
-    BEEF beef = e.update<BEEF> ([pr, opts] (Interface::writable u) -> BEEF {
+    if (bool (unsigned_file)) {
+        list<nosig::transaction> txs = e.update<list<nosig::transaction>> ([pr, opts] (Interface::writable u) {
+            auto payments = *u.get ().payments ();
+            if (bool (payments.Unsigned.contains (pr->Key)) || bool (payments.Proposals.contains (pr->Key)))
+                throw exception {} << "there is already a payment to " << pr->Key << " waiting to be completed";
 
-        Bitcoin::address addr {pr->Key};
-        Bitcoin::pubkey pubkey {pr->Key};
-        HD::BIP_32::pubkey xpub {pr->Key};
-
-        spend::spent spent;
-        if (addr.valid ()) {
-            spent = u.make_tx ({Bitcoin::output {*pr->Value.Amount, pay_to_address::script (addr.digest ())}}, opts);
-        } else if (pubkey.valid ()) {
-            spent = u.make_tx ({Bitcoin::output {*pr->Value.Amount, pay_to_pubkey::script (pubkey)}}, opts);
-        } else if (xpub.valid ()) {
-            throw exception {} << "pay to xpub not yet implemented";
-        } else throw exception {} << "could not read payment address " << pr->Key;
-        std::cout << " generating SPV proof " << std::endl;
-        maybe<SPV::proof> ppp = generate_proof (*u.local_txdb (),
-            for_each ([] (const auto &e) -> Bitcoin::transaction {
-                return Bitcoin::transaction (e.first);
-            }, spent.Transactions));
+            spend::spent_unsigned spent = u.make_unsigned_tx ({payment_output (*pr)}, opts);
 
-        if (!bool (ppp)) throw exception {} << "failed to generate payment";
+            // new change addresses have been generated.
+            u.set_addresses (spent.Addresses);
 
-        std::cout << "SPV proof generated containing " << ppp->Payment.size () <<
-            " transactions and " << ppp->Proof.size () << " antecedents" << std::endl;
+            // the outputs that these txs spend are kept out of other payments until
+            // the signed txs are read back with --signed and the payee accepts them.
+            u.set_payments (Cosmos::payments {payments.Requests, payments.Proposals,
+                payments.Unsigned.insert (pr->Key, payments::unsigned_offer {*pr,
+                    for_each ([] (const auto &e) -> account_diff {
+                        return e.second;
+                    }, spent.Transactions)})});
+
+            return for_each ([] (const auto &e) -> nosig::transaction {
+                return e.first;
+            }, spent.Transactions);
+        });
 
-        BEEF beef {*ppp};
-        std::cout << "Beef produced containing " << beef.Transactions.size () <<
-            " transactions and " << beef.BUMPs.size () << " proofs" << std::endl;
+        // one tx per line, which is what sign reads.
+        std::ofstream file {*unsigned_file, std::ios::out};
+        if (!file) throw exception {2} << "could not open file " << *unsigned_file;
+        for (const nosig::transaction &tx : txs) file << JSON (tx).dump () << "\n";
 
-        wait_for_enter ("Press enter to continue.");
+        std::cout << txs.size () << " unsigned transactions written to " << *unsigned_file <<
+            "; sign them with the sign command on the machine that holds the keys and"
+            " then read them back with pay --signed." << std::endl;
 
-        // save to proposed payments.
-        auto payments = *u.get ().payments ();
-        u.set_payments (Cosmos::payments {payments.Requests, payments.Proposals.insert (pr->Key, payments::offer
-            {*pr, beef, for_each ([] (const auto &e) -> account_diff {
-                return e.second;
-            }, spent.Transactions)})});
+        delete pr;
+        return;
+    }
 
-        return beef;
+    BEEF beef = e.update<BEEF> ([pr, opts] (Interface::writable u) -> BEEF {
+        return make_payment (u, *pr, opts);
     });
 
-    if (bool (output)) {
-        // TODO make sure that the output doesn't already exist.
-        write_to_file (encoding::base64::write (bytes (beef)), *output);
-        std::cout << "offer written to " << *output << std::endl;
-    } else std::cout << "please show this string to your seller and he will broadcast the payment if he accepts it:\n\t" <<
-        encoding::base64::write (bytes (beef)) << std::endl;
+    show_offer (beef, output);
 
     delete pr;
 }
 
+// sign a file of unsigned transactions, one JSON object per line, and
+// write the signed transactions in hex, one per line.
 void command_sign (const arg_parser &p) {
-    throw exception {} << "Commond sign not yet implemented";
+    using namespace Cosmos;
+    Interface e {};
+    read_both_chains_options (e, p);
+
+    maybe<std::string> input_file;
+    p.get (3, "input", input_file);
+    if (!bool (input_file)) throw exception {2} << "no input file provided";
+
+    maybe<std::string> output_file;
+    p.get (4, "output", output_file);
+
+    auto *keys = e.keys ();
+    auto *pubkeys = e.pubkeys ();
+    if (keys == nullptr || pubkeys == nullptr) throw exception {} << "could not load keys";
+
+    std::ifstream in {*input_file};
+    if (!in) throw exception {2} << "could not open file " << *input_file;
+
+    std::ofstream file;
+    if (bool (output_file)) {
+        file.open (*output_file, std::ios::out);
+        if (!file) throw exception {2} << "could not open file " << *output_file;
+    }
+
+    std::ostream &out = bool (output_file) ? static_cast<std::ostream &> (file) : std::cout;
+
+    // every transaction is signed with the same cache so that
+    // keys shared between them are only derived once.
+    derivation_cache cache {};
+    uint32 signed_txs {0};
+    uint32 signed_inputs {0};
+
+    std::string line;
+    while (std::getline (in, line)) {
+        if (line.empty ()) continue;
+        nosig::transaction tx {JSON::parse (line)};
+        extended_transaction complete = tx.sign (*keys, *pubkeys, cache);
+        if (!complete.valid ()) throw exception {3} << "invalid tx generated from line " << (signed_txs + 1);
+        out << encoding::hex::write (bytes (Bitcoin::transaction (complete))) << "\n";
+        signed_txs++;
+        signed_inputs += tx.Inputs.size ();
+    }
+
+    out.flush ();
+
+    std::cerr << "signed " << signed_txs << " transactions with " << signed_inputs << " inputs; " << cache << std::endl;
 }
 
 // TODO get fee rate from options.
@@ -531,7 +917,7 @@ void command_taxes (const arg_parser &p) {
     std::tm tm_end = {0, 0, 0, 1, 0, *tax_year - 1900 + 1};
 
     begin = Bitcoin::timestamp {std::mktime (&tm_begin)};
-    end = Bitcoin::timestamp {std::mktime (&tm_begin)};
+    end = Bitcoin::timestamp {std::mktime (&tm_end)};
 
     // TODO there are also issues related to time zone
     // and the tax year.
@@ -544,8 +930,21 @@ void command_taxes (const arg_parser &p) {
         auto *h = u.history ();
         if (h == nullptr) throw exception {} << "could not read wallet history";
 
+        auto *l = u.ledger ();
+        if (l == nullptr) throw exception {} << "could not read tax ledger";
+
+        // txs that were unconfirmed when they were added may have been mined since.
+        h->update (*u.local_txdb ());
+
+        // only txs that have been added to the history since the last time are priced.
+        if (size_t unconfirmed = l->update (*h, *u.price_data ()); unconfirmed > 0)
+            std::cout << "WARNING: " << unconfirmed << " unconfirmed txs are not included. Run update to check for confirmations." << std::endl;
+
+        tax t = tax::calculate (*l, begin, end);
+        t.Account = h->get (end).Account;
+
         std::cout << "Tax implications: " << std::endl;
-        std::cout << tax::calculate (*u.txdb (), u.price_data (), h->get (begin, end)) << std::endl;
+        std::cout << t << std::endl;
     });
 }
 
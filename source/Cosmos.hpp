@@ -35,7 +35,10 @@ enum class method {
     SEND,     // (depricated) send bitcoin to an address.
     BOOST,    // boost some content
     SPLIT,    // split your wallet into tiny pieces for privacy.
-    TAXES     // calculate income and capital gain for a given year.
+    CONSOLIDATE, // merge tiny pieces of your wallet back together.
+    TAXES,    // calculate income and capital gain for a given year.
+    EXPORT,   // write history or tax data to a csv or ndjson file.
+    DAEMON    // keep the wallet in memory and serve commands over a socket.
 };
 
 void version ();
@@ -54,7 +57,10 @@ void command_send (const arg_parser &);     // depricated
 void command_import (const arg_parser &);
 void command_boost (const arg_parser &);    // offline
 void command_split (const arg_parser &);
+void command_consolidate (const arg_parser &);
 void command_taxes (const arg_parser &);    // offline
+void command_export (const arg_parser &);
+void command_daemon (const arg_parser &);
 
 // TODO offline methods function without an internet connection.
 
@@ -1,29 +1,87 @@
 #include <Cosmos/database/json/price_data.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 namespace Cosmos {
 
     JSON_price_data::JSON_price_data (const JSON &j) {
-        for (const JSON &x : j) Price[Bitcoin::timestamp {uint32 (x[0])}] = double (x[1]);
+        if (j == JSON (nullptr)) return;
+
+        // the old format was a list of prices by the second.
+        if (j.is_array ()) {
+            for (const JSON &x : j) set (Bitcoin::timestamp {uint32 (x[0])}, double (x[1]));
+            return;
+        }
+
+        if (!j.is_object () || !j.contains ("first_day") || !j.contains ("daily"))
+            throw exception {} << "invalid price data JSON format";
+
+        FirstDay = uint32 (j["first_day"]);
+        Daily.reserve (j["daily"].size ());
+        for (const JSON &x : j["daily"])
+            Daily.push_back (x.is_number () ? double (x) : std::numeric_limits<double>::quiet_NaN ());
+
+        if (j.contains ("fetched")) for (const JSON &x : j["fetched"])
+            Fetched.push_back ({uint32 (x[0]), uint32 (x[1])});
     }
 
     JSON_price_data::operator JSON () const {
-        JSON::array_t data {};
-        for (const auto &[key, value] : Price)
-            data.push_back (JSON::array_t {uint32 (key), value});
+        JSON::array_t daily {};
+        daily.reserve (Daily.size ());
+        for (double p : Daily)
+            if (std::isnan (p)) daily.push_back (nullptr);
+            else daily.push_back (p);
 
-        return data;
+        JSON::object_t j;
+        j["first_day"] = FirstDay;
+        j["daily"] = daily;
+
+        JSON::array_t fetched {};
+        for (const auto &[first, last] : Fetched) fetched.push_back (JSON::array_t {first, last});
+        j["fetched"] = fetched;
+
+        return j;
     }
 
     maybe<double> JSON_price_data::get (const Bitcoin::timestamp &t) {
-        if (auto x = Price.find (t); x != Price.end ()) return x->second;
-        return {};
+        uint32 d = day (t);
+        if (d < FirstDay || d - FirstDay >= Daily.size () || std::isnan (Daily[d - FirstDay])) return {};
+        return Daily[d - FirstDay];
     }
 
     void JSON_price_data::set (const Bitcoin::timestamp &t, double p) {
-        if (auto x = Price.find (t); x != Price.end () &&
-            !(x->second - p == 0 || (std::max (x->second, p) / std::abs (x->second - p)) < .005))
-                throw exception {} << " We already have a different value for that price already: " << x->second << " vs " << p;
-        Price[t] = p;
+        uint32 d = day (t);
+        constexpr double missing = std::numeric_limits<double>::quiet_NaN ();
+
+        if (Daily.empty ()) FirstDay = d;
+        else if (d < FirstDay) {
+            Daily.insert (Daily.begin (), FirstDay - d, missing);
+            FirstDay = d;
+        }
+
+        if (d - FirstDay >= Daily.size ()) Daily.resize (d - FirstDay + 1, missing);
+
+        Daily[d - FirstDay] = p;
+    }
+
+    bool JSON_price_data::fetched (uint32 d) {
+        for (const auto &[first, last] : Fetched) if (first <= d && d <= last) return true;
+        return false;
     }
-}
 
+    void JSON_price_data::set_fetched (uint32 first_day, uint32 last_day) {
+        if (first_day > last_day) return;
+        Fetched.push_back ({first_day, last_day});
+        std::sort (Fetched.begin (), Fetched.end ());
+
+        // merge ranges that overlap or touch.
+        std::vector<std::pair<uint32, uint32>> merged;
+        for (const auto &r : Fetched)
+            if (merged.size () > 0 && r.first <= merged.back ().second + 1)
+                merged.back ().second = std::max (merged.back ().second, r.second);
+            else merged.push_back (r);
+
+        Fetched = merged;
+    }
+}
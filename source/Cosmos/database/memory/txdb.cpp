@@ -1,4 +1,5 @@
 #include <Cosmos/database/memory/txdb.hpp>
+#include <algorithm>
 
 namespace Cosmos {
 
@@ -14,46 +15,44 @@ namespace Cosmos {
         else AddressIndex[addr] = list<Bitcoin::outpoint> {op};
     }
 
-    events memory_local_TXDB::by_address (const Bitcoin::address &a) {
-
-        auto zz = AddressIndex.find (a);
-        if (zz == AddressIndex.end ()) return {};
-        events n;
+    namespace {
+        // all events for a list of outputs, sorted once at the end.
+        events outputs_and_redeemers (memory_local_TXDB &txdb,
+            const std::map<Bitcoin::outpoint, inpoint> &redeemers, list<Bitcoin::outpoint> outputs) {
+            std::vector<event> n;
 
-        for (const Bitcoin::outpoint &o : zz->second) {
-            ptr<vertex> confirmed = (*this) [o.Digest];
-            if (confirmed == nullptr) return {};
-            n = n.insert (event {confirmed, o.Index, direction::out});
+            for (const Bitcoin::outpoint &o : outputs) {
+                ptr<vertex> confirmed = txdb[o.Digest];
+                if (confirmed == nullptr) return {};
+                n.push_back (event {confirmed, o.Index, direction::out});
 
-            if (auto v = RedeemIndex.find (o); v != RedeemIndex.end ()) {
-                ptr<vertex> redeemer = (*this) [v->second.Digest];
-                if (redeemer == nullptr) return {};
-                n = n.insert (event {redeemer, v->second.Index, direction::in});
+                if (auto v = redeemers.find (o); v != redeemers.end ()) {
+                    ptr<vertex> redeemer = txdb[v->second.Digest];
+                    if (redeemer == nullptr) return {};
+                    n.push_back (event {redeemer, v->second.Index, direction::in});
+                }
             }
+
+            std::sort (n.begin (), n.end (), [] (const event &a, const event &b) -> bool {
+                return a < b;
+            });
+
+            stack<event> x;
+            for (auto e = n.rbegin (); e != n.rend (); e++) x <<= *e;
+            return events (x);
         }
+    }
 
-        return n;
+    events memory_local_TXDB::by_address (const Bitcoin::address &a) {
+        auto zz = AddressIndex.find (a);
+        if (zz == AddressIndex.end ()) return {};
+        return outputs_and_redeemers (*this, RedeemIndex, zz->second);
     }
 
     events memory_local_TXDB::by_script_hash (const digest256 &x) {
-
         auto zz = ScriptIndex.find (x);
         if (zz == ScriptIndex.end ()) return {};
-        events n;
-
-        for (const Bitcoin::outpoint &o : zz->second) {
-            ptr<vertex> confirmed = (*this) [o.Digest];
-            if (confirmed == nullptr) return {};
-            n = n.insert (event {confirmed, o.Index, direction::out});
-
-            if (auto v = RedeemIndex.find (o); v != RedeemIndex.end ()) {
-                ptr<vertex> redeemer = (*this) [v->second.Digest];
-                if (redeemer == nullptr) return {};
-                n = n.insert (event {redeemer, v->second.Index, direction::in});
-            }
-        }
-
-        return n;
+        return outputs_and_redeemers (*this, RedeemIndex, zz->second);
     }
 
     event memory_local_TXDB::redeeming (const Bitcoin::outpoint &o) {
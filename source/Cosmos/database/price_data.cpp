@@ -1,12 +1,63 @@
 #include <Cosmos/database/price_data.hpp>
+#include <algorithm>
 
 namespace Cosmos {
 
+    namespace {
+        constexpr uint32 seconds_per_day = 86400;
+        constexpr uint32 days_per_request = 365;
+    }
+
     maybe<double> cached_remote_price_data::get (const Bitcoin::timestamp &t) {
         auto v = Local.get (t);
         if (bool (v)) return *v;
+
+        // get the whole year around this time at once since we will probably need more of it.
+        uint32 day = uint32 (t) / seconds_per_day;
+        uint32 first = day > days_per_request / 2 ? day - days_per_request / 2 : 0;
+        prefetch (Bitcoin::timestamp {first * seconds_per_day},
+            Bitcoin::timestamp {(first + days_per_request) * seconds_per_day});
+
+        v = Local.get (t);
+        if (bool (v)) return *v;
+
+        // CoinGecko has no price for this day.
+        if (Local.fetched (day)) return {};
+
         double p = Net.price (t);
         Local.set (t, p);
         return p;
     }
+
+    void cached_remote_price_data::prefetch (const Bitcoin::timestamp &from, const Bitcoin::timestamp &to) {
+        // the price for today may not be known yet, so we don't remember that we have asked for it.
+        uint32 today = uint32 (Bitcoin::timestamp::now ()) / seconds_per_day;
+
+        uint32 last = uint32 (to) / seconds_per_day;
+        for (uint32 begin = uint32 (from) / seconds_per_day; begin <= last; begin += days_per_request) {
+            uint32 end = std::min (begin + days_per_request - 1, last);
+
+            bool missing = false;
+            for (uint32 d = begin; d <= end; d++) if (!Local.fetched (d) && !bool (Local.get (Bitcoin::timestamp {d * seconds_per_day}))) {
+                missing = true;
+                break;
+            }
+
+            if (!missing) continue;
+
+            // for ranges of 90 days or less, CoinGecko gives hourly prices rather than daily.
+            // Either way we take the first price of each day, which is the daily price if
+            // there is only one.
+            maybe<uint32> previous_day;
+            for (const auto &[t, p] : Net.price_range (Bitcoin::timestamp {begin * seconds_per_day},
+                Bitcoin::timestamp {(end + 1) * seconds_per_day})) {
+                uint32 day = uint32 (t) / seconds_per_day;
+                if (bool (previous_day) && *previous_day == day) continue;
+                Local.set (t, p);
+                previous_day = day;
+            }
+
+            if (begin < today) Local.set_fetched (begin, std::min (end, today - 1));
+        }
+    }
 }
@@ -2,6 +2,7 @@
 #include <gigamonkey/merkle/BUMP.hpp>
 #include <filesystem>
 #include <fstream>
+#include <limits>
 
 namespace Cosmos {
 
@@ -57,18 +58,70 @@ namespace Cosmos {
         bytes tx = Net.get_transaction (txid);
         if (tx.size () == 0) return false;
 
-        auto proof = Net.WhatsOnChain.transaction ().get_merkle_proof (txid);
+        return import_transaction (downloaded {txid, tx, Net.WhatsOnChain.transaction ().get_merkle_proof (txid)});
+    }
+
+    cached_remote_TXDB::downloaded cached_remote_TXDB::download (whatsonchain &API, const Bitcoin::TXID &txid) {
+        bytes tx = API.transaction ().get_raw (txid);
+        if (tx.size () == 0) return downloaded {txid, tx, {}};
+        return downloaded {txid, tx, API.transaction ().get_merkle_proof (txid)};
+    }
 
-        if (!bool (proof)) {
-            Local.insert (Bitcoin::transaction {tx});
+    bool cached_remote_TXDB::import_transaction (const downloaded &d) {
+        if (d.Transaction.size () == 0) return false;
+
+        if (!bool (d.Proof)) {
+            Local.insert (Bitcoin::transaction {d.Transaction});
             return true;
         }
 
-        if (!proof->Proof.valid ()) return false;
-        const entry<N, Bitcoin::header> *h = Local.header (proof->BlockHash);
-        if (!bool (h)) h = import_header (Local, Net, proof->BlockHash);
+        if (!d.Proof->Proof.valid ()) return false;
+        const entry<N, Bitcoin::header> *h = Local.header (d.Proof->BlockHash);
+        if (!bool (h)) h = import_header (Local, Net, d.Proof->BlockHash);
         if (!bool (h)) return false;
-        return Local.import_transaction (Bitcoin::transaction {tx}, Merkle::path (proof->Proof.Branch), h->Value);
+        return Local.import_transaction (Bitcoin::transaction {d.Transaction}, Merkle::path (d.Proof->Proof.Branch), h->Value);
+    }
+
+    set<Bitcoin::TXID> cached_remote_TXDB::import_transactions (list<Bitcoin::TXID> txids) {
+        set<Bitcoin::TXID> found;
+        set<Bitcoin::TXID> checked;
+        list<Bitcoin::TXID> check;
+
+        for (const Bitcoin::TXID &txid : txids) {
+            if (found.contains (txid) || checked.contains (txid)) continue;
+            auto known = Local.transaction (txid);
+            if (known.valid () && known.confirmed ()) found = found.insert (txid);
+            else {
+                checked = checked.insert (txid);
+                check <<= txid;
+            }
+        }
+
+        if (data::size (check) == 0) return found;
+
+        // proofs and txs are downloaded one at a time because whatsonchain
+        // has no bulk endpoint for proofs. Headers are only downloaded
+        // once per block since they are kept in the local database.
+        for (const auto &status : Net.WhatsOnChain.transaction ().get_status (check)) {
+            // a tx that we have but that the network does not know has not been
+            // accepted, so it is not returned even though it is in the database.
+            if (!status.Known) continue;
+
+            auto known = Local.transaction (status.TXID);
+            found = found.insert (status.TXID);
+
+            // still unconfirmed and we already have it.
+            if (!bool (status.BlockHash) && known.valid ()) continue;
+
+            downloaded d {status.TXID,
+                known.valid () ? bytes (*known.Transaction) : Net.WhatsOnChain.transaction ().get_raw (status.TXID),
+                bool (status.BlockHash) ? Net.WhatsOnChain.transaction ().get_merkle_proof (status.TXID) :
+                    maybe<whatsonchain::merkle_proof> {}};
+
+            import_transaction (d);
+        }
+
+        return found;
     }
 
     events cached_remote_TXDB::by_address (const Bitcoin::address &a) {
@@ -200,21 +253,40 @@ namespace Cosmos {
     std::partial_ordering when::operator <=> (const when &w) const {
         if (*this == w) return *this == unconfirmed () ? std::partial_ordering::unordered : std::partial_ordering::equivalent;
         // so we know that they are not equal.
-        if (this->is<bool> ()) this->get<bool> () ? std::partial_ordering::greater : std::partial_ordering::less;
+        if (this->is<bool> ()) return this->get<bool> () ? std::partial_ordering::greater : std::partial_ordering::less;
         if (w.is<bool> ()) return w.get<bool> () ? std::partial_ordering::less : std::partial_ordering::greater;
         // they must both be timestamps at this point.
         return *this == unconfirmed () ? std::partial_ordering::greater : this->get<Bitcoin::timestamp> () <=> w.get<Bitcoin::timestamp> ();
     }
 
+    namespace {
+        // the longest chain of unconfirmed txs in a proof.
+        uint64 unconfirmed_depth (const SPV::proof::map &m) {
+            uint64 depth = 0;
+            for (const auto &[_, node] : m) if (!node->Proof.is<SPV::confirmation> ())
+                depth = std::max (depth, unconfirmed_depth (node->Proof.get<SPV::proof::map> ()) + 1);
+            return depth;
+        }
+    }
+
+    vertex::sort_key vertex::sort_key::make (const SPV::proof::tree &p) {
+        if (p.is<SPV::confirmation> ()) {
+            const SPV::confirmation &c = p.get<SPV::confirmation> ();
+            return sort_key {uint64 (c.Height), uint64 (c.Path.Index)};
+        }
+
+        return sort_key {std::numeric_limits<uint64>::max (), unconfirmed_depth (p.get<SPV::proof::map> ())};
+    }
+
     std::partial_ordering event::operator <=> (const event &e) const {
         if (!valid () || !e.valid ()) throw exception {} << "invalid tx.";
 
-        auto compare_tx = SPV::proof::ordering ((*this)->Proof, e->Proof);
+        auto compare_tx = **this <=> *e;
 
         if (compare_tx != std::partial_ordering::equivalent) return compare_tx;
         if (Direction != e.Direction) return Direction == direction::in ? std::partial_ordering::less : std::partial_ordering::greater;
 
-        return Index <=> Index;
+        return Index <=> e.Index;
     }
 
     ptr<vertex> TXDB::operator [] (const Bitcoin::TXID &id) {
@@ -0,0 +1,127 @@
+
+#include <Cosmos/export.hpp>
+#include <algorithm>
+#include <iomanip>
+
+namespace Cosmos {
+
+    maybe<export_format> read_export_format (const std::string &x) {
+        if (x == "csv") return export_format::csv;
+        if (x == "ndjson" || x == "jsonl") return export_format::ndjson;
+        return {};
+    }
+
+    exporter::value::value (double x) : Quoted {false} {
+        std::stringstream ss;
+        ss << std::setprecision (17) << x;
+        Value = ss.str ();
+    }
+
+    void exporter::begin (std::vector<std::string> columns) {
+        Columns = columns;
+        if (Format != export_format::csv) return;
+
+        bool first = true;
+        for (const std::string &c : Columns) {
+            if (!first) Out << ",";
+            Out << c;
+            first = false;
+        }
+        Out << "\n";
+    }
+
+    void exporter::row (std::initializer_list<value> values) {
+        if (values.size () != Columns.size ()) throw exception {} << "wrong number of columns in export";
+
+        auto column = Columns.begin ();
+        bool first = true;
+
+        if (Format == export_format::csv) {
+            for (const value &v : values) {
+                if (!first) Out << ",";
+                first = false;
+                // fields with commas, quotes, or newlines are quoted.
+                if (v.Value.find_first_of (",\"\n") == std::string::npos) Out << v.Value;
+                else {
+                    Out << '"';
+                    for (char c : v.Value) {
+                        if (c == '"') Out << '"';
+                        Out << c;
+                    }
+                    Out << '"';
+                }
+            }
+        } else {
+            Out << "{";
+            for (const value &v : values) {
+                if (!first) Out << ",";
+                first = false;
+                Out << JSON (*column++).dump () << ":";
+                if (v.Quoted) Out << JSON (v.Value).dump ();
+                else Out << v.Value;
+            }
+            Out << "}";
+        }
+
+        Out << "\n";
+    }
+
+    namespace {
+        std::string write_when (const when &w) {
+            if (w == when::unconfirmed ()) return "unconfirmed";
+            return std::to_string (uint32 (w.get<Bitcoin::timestamp> ()));
+        }
+    }
+
+    void exporter::history (const Cosmos::history &h, when from, when to) {
+        begin ({"txid", "time", "direction", "point", "value", "redeems"});
+
+        size_t confirmed = h.Events.size ();
+        while (confirmed > 0 && h.Events[confirmed - 1].When == when::unconfirmed ()) confirmed--;
+
+        auto before = [] (const Cosmos::history::tx &e, const when &w) -> bool {
+            return e.When < w;
+        };
+
+        auto first = std::lower_bound (h.Events.begin (), h.Events.begin () + confirmed, from, before);
+        auto last = to == when::infinity () ? h.Events.end () :
+            std::lower_bound (first, h.Events.begin () + confirmed, to, before);
+
+        for (auto e = first; e != last; e++) {
+            std::string txid = write (e->TXID);
+            std::string time = write_when (e->When);
+            for (const Cosmos::history::record &r : e->Events) row ({
+                txid, time,
+                r.Direction == direction::in ? "in" : "out",
+                write (r.Point),
+                int64 (r.Value),
+                r.Direction == direction::in ? write (r.Reference) : std::string {}});
+        }
+
+        Out.flush ();
+    }
+
+    void exporter::ledger (const Cosmos::ledger &l, when from, when to) {
+        begin ({"type", "txid", "time", "price", "point", "value", "acquired", "cost_price"});
+
+        auto before = [] (const Cosmos::ledger::entry &e, const when &w) -> bool {
+            return when {e.When} < w;
+        };
+
+        auto first = std::lower_bound (l.Entries.begin (), l.Entries.end (), from, before);
+        auto last = std::lower_bound (first, l.Entries.end (), to, before);
+
+        for (auto e = first; e != last; e++) {
+            std::string txid = write (e->TXID);
+            uint32 time = uint32 (e->When);
+
+            for (const auto &[op, lot] : e->Disposed)
+                row ({"disposal", txid, time, e->Price, write (op), int64 (lot.Value), uint32 (lot.Acquired), lot.Price});
+
+            if (e->Income > 0) row ({"income", txid, time, e->Price, std::string {}, int64 (e->Income), time, e->Price});
+        }
+
+        Out.flush ();
+    }
+
+}
@@ -1,5 +1,8 @@
 
 #include <Cosmos/history.hpp>
+#include <algorithm>
+#include <iterator>
+#include <set>
 
 namespace Cosmos {
     namespace {
@@ -17,13 +20,18 @@ namespace Cosmos {
             throw exception {} << "invalid history direction format";
         }
 
-        JSON write_event (const event &r) {
+        JSON write_record (const history::record &r) {
             JSON::object_t o;
-            o["point"] = write (Bitcoin::outpoint {r.id (), r.Index});
+            o["point"] = write (r.Point);
             o["direction"] = write_direction (r.Direction);
+            o["value"] = write (r.Value);
+            if (r.Direction == direction::in) o["redeems"] = write (r.Reference);
+            else o["output"] = write (r.Output);
             return o;
         }
 
+        // histories written before records were saved only have
+        // the point and the direction and must be looked up.
         event read_event (const JSON &j, TXDB &txdb) {
 
             Bitcoin::outpoint point;
@@ -62,6 +70,21 @@ namespace Cosmos {
             return event {txdb[point.Digest], point.Index, dir};
         }
 
+        history::record read_record (const JSON &j, TXDB &txdb) {
+            if (!j.is_object ()) throw exception {} << "invalid JSON history event format";
+
+            auto value = j.find ("value");
+            if (value == j.end ()) return history::record {read_event (j, txdb)};
+
+            history::record r {};
+            r.Point = read_outpoint (std::string (j["point"]));
+            r.Direction = read_direction (j["direction"]);
+            r.Value = read_satoshi (*value);
+            if (r.Direction == direction::in) r.Reference = read_outpoint (std::string (j["redeems"]));
+            else r.Output = read_output (j["output"]);
+            return r;
+        }
+
         JSON write_tx (const history::tx &e) {
 
             JSON::object_t o;
@@ -73,7 +96,7 @@ namespace Cosmos {
             JSON::array_t a;
             a.resize (e.Events.size ());
             int i = 0;
-            for (const event &r : e.Events) a[i++] = write_event (r);
+            for (const history::record &r : e.Events) a[i++] = write_record (r);
             o["events"] = a;
             return o;
 
@@ -102,9 +125,7 @@ namespace Cosmos {
             e.Received = read_satoshi (*received);
             e.Spent = read_satoshi (*spent);
             e.Moved = read_satoshi (*moved);
-            stack<event> evv;
-            for (const auto &jj : *events) evv <<= read_event (jj, txdb);
-            e.Events = ordered_list<event> (data::reverse (evv));
+            for (const auto &jj : *events) e.Events <<= read_record (jj, txdb);
             return e;
 
         }
@@ -136,9 +157,8 @@ namespace Cosmos {
         ev["received"] = write (Received);
 
         JSON::array_t events;
-        events.resize (Events.size ());
-        int i = Events.size () - 1;
-        for (const tx &e : Events) events[i--] = write_tx (e);
+        events.reserve (Events.size ());
+        for (const tx &e : Events) events.push_back (write_tx (e));
         ev["events"] = events;
 
         JSON::object_t account;
@@ -146,7 +166,7 @@ namespace Cosmos {
         ev["account"] = account;
 
         JSON::array_t payments;
-        i = Events.size () - 1;
+        int i = Events.size () - 1;
         for (const payment &p : Payments) payments[i--] = write_payment (p);
         ev["payments"] = payments;
 
@@ -182,7 +202,16 @@ namespace Cosmos {
 
         for (const auto &[key, value] : j["account"].items ()) Account[read_outpoint (key)] = read_output (value);
 
-        for (const auto &jj : j["events"]) Events <<= read_tx (jj, txdb);
+        Events.reserve (j["events"].size ());
+        for (const auto &jj : j["events"]) Events.push_back (read_tx (jj, txdb));
+
+        // regenerate the checkpoints.
+        account current {};
+        Checkpoints.reserve (Events.size () / CheckpointInterval + 1);
+        for (size_t n = 0; n < Events.size (); n++) {
+            if (n % CheckpointInterval == 0) Checkpoints.push_back (current);
+            apply (current, Events[n].Events);
+        }
 
         // this is a new feature.
         auto payments = j.find ("payment");
@@ -190,101 +219,263 @@ namespace Cosmos {
 
     }
 
-    // get all events corresponding to the same tx.
-    events get_next_tx (events &e) {
-        if (data::size (e) == 0) return {};
+    namespace {
 
-        stack<event> next_tx;
-        const auto &txid = e.first ().id ();
+        // where a tx at the given time goes. Unconfirmed txs stay
+        // at the end in the order in which they were added.
+        size_t insert_position (const std::vector<history::tx> &ev, const when &w) {
+            if (w == when::unconfirmed ()) return ev.size ();
 
-        while (true) {
-            next_tx = next_tx << e.first ();
+            size_t confirmed = ev.size ();
+            while (confirmed > 0 && ev[confirmed - 1].When == when::unconfirmed ()) confirmed--;
 
-            e = e.rest ();
+            return std::upper_bound (ev.begin (), ev.begin () + confirmed, w,
+                [] (const when &x, const history::tx &e) -> bool {
+                    return x < e.When;
+                }) - ev.begin ();
+        }
 
-            if (data::size (e) == 0 || e.first ().id () != txid) return reverse (next_tx);
+        bool has_record (list<history::record> records, const history::record &r) {
+            for (const history::record &x : records)
+                if (x.Point == r.Point && x.Direction == r.Direction) return true;
+            return false;
+        }
+
+        history::tx make_tx (const Bitcoin::TXID &txid, const when &w, list<history::record> records) {
+            history::tx next {};
+            next.TXID = txid;
+            next.When = w;
+            next.Events = records;
+
+            Bitcoin::satoshi received = 0;
+            Bitcoin::satoshi spent = 0;
+
+            for (const history::record &current : records)
+                if (current.Direction == direction::in) spent += current.Value;
+                else received += current.Value;
+
+            // this is not correct. It is theoretically possible to
+            // receive and spend at the same time, although you
+            // wouldn't normally do that.
+            if (received > spent) {
+                next.Spent = 0;
+                next.Moved = spent;
+                next.Received = received - spent;
+            } else {
+                next.Received = 0;
+                next.Moved = received;
+                next.Spent = spent - received;
+            }
+
+            return next;
         }
     }
 
     history &history::operator <<= (events e) {
         if (data::empty (e)) return *this;
 
-        if (!data::empty (Events) && data::first (e) < data::first (Events).Events.first ())
-            throw exception {} << "must be later than latest event";
+        // events may come from several address sequences, so we
+        // put them in order and group them by tx.
+        std::vector<event> sorted;
+        for (const event &x : e) sorted.push_back (x);
+        std::sort (sorted.begin (), sorted.end (), [] (const event &a, const event &b) -> bool {
+            return a < b;
+        });
 
-        while (true) {
-            const auto &next = e.first ();
+        sorted.erase (std::unique (sorted.begin (), sorted.end ()), sorted.end ());
 
-            tx next_event {};
-            next_event.Events = get_next_tx (e);
+        // unconfirmed txs are always at the end.
+        size_t confirmed = Events.size ();
+        while (confirmed > 0 && Events[confirmed - 1].When == when::unconfirmed ()) confirmed--;
 
-            if (data::size (next_event.Events) == 0) return *this;
+        std::set<Bitcoin::TXID> known;
+        for (const tx &x : Events) known.insert (x.TXID);
 
-            next_event.TXID = next.id ();
-            next_event.When = next->when ();
+        // records for txs that we already have. A tx can have events in several
+        // sequences, so these may add to it, and it may have been unconfirmed before.
+        std::map<Bitcoin::TXID, std::pair<when, list<record>>> updates;
 
-            Bitcoin::satoshi received = 0;
-            Bitcoin::satoshi spent = 0;
+        std::vector<tx> added;
+        for (auto it = sorted.begin (); it != sorted.end ();) {
+            Bitcoin::TXID txid = it->id ();
+            when w = (*it)->when ();
 
-            for (const event &current : next_event.Events) if (current.Direction == direction::in) {
-                // delete the output from the account
-                this->Account.erase (Bitcoin::input {current.put ()}.Reference);
+            list<record> records;
+            for (; it != sorted.end () && it->id () == txid; it++) records <<= record {*it};
 
-                spent += current.value ();
-            } else {
-                Bitcoin::output output = Bitcoin::output {current.put ()};
-                this->Account[current.point ()] = output;
+            if (!known.contains (txid)) added.push_back (make_tx (txid, w, records));
+            else updates[txid] = {w, records};
+        }
 
-                received += current.value ();
-            }
+        // the earliest position that will change.
+        size_t changed = Events.size ();
+
+        // txs that are changed are taken out of the history and put back with the new ones.
+        std::vector<tx> kept;
+        std::vector<tx> pending;
+        kept.reserve (confirmed);
+        for (size_t n = 0; n < Events.size (); n++) {
+            const tx &old = Events[n];
+            if (auto u = updates.find (old.TXID); u != updates.end ()) {
+                list<record> records = old.Events;
+                bool new_records = false;
+                for (const record &r : u->second.second) if (!has_record (old.Events, r)) {
+                    records <<= r;
+                    new_records = true;
+                }
 
-            // this is not correct. It is theoretically possible to
-            // receive and spend at the same time, although you
-            // wouldn't normally do that.
-            if (received > spent) {
-                next_event.Spent = 0;
-                next_event.Moved = spent;
-                next_event.Received = received - spent;
-            } else {
-                next_event.Received = 0;
-                next_event.Moved = received;
-                next_event.Spent = spent - received;
+                bool mined = old.When == when::unconfirmed () && u->second.first != when::unconfirmed ();
+
+                if (new_records || mined) {
+                    // the totals are counted again below.
+                    Received -= old.Received;
+                    Spent -= old.Spent;
+                    Value -= old.Received;
+                    Value += old.Spent;
+
+                    added.push_back (make_tx (old.TXID, mined ? u->second.first : old.When, records));
+                    changed = std::min (changed, n);
+                    continue;
+                }
             }
 
-            Events <<= next_event;
+            if (n < confirmed) kept.push_back (old);
+            else pending.push_back (old);
+        }
 
-            Received += next_event.Received;
-            Spent += next_event.Spent;
-            Value += next_event.Received;
-            Value -= next_event.Spent;
+        if (added.size () == 0) return *this;
 
+        for (const tx &x : added) {
+            Received += x.Received;
+            Spent += x.Spent;
+            Value += x.Received;
+            Value -= x.Spent;
         }
 
+        // unconfirmed txs compare equal to each other, so a stable sort keeps them in order.
+        auto earlier = [] (const tx &a, const tx &b) -> bool {
+            return a.When < b.When;
+        };
+
+        std::stable_sort (added.begin (), added.end (), earlier);
+
+        auto first_unconfirmed = std::find_if (added.begin (), added.end (), [] (const tx &x) -> bool {
+            return x.When == when::unconfirmed ();
+        });
+
+        changed = std::min (changed, insert_position (Events, added.front ().When));
+
+        // new txs go after txs that we already had at the same time.
+        std::vector<tx> merged;
+        merged.reserve (kept.size () + pending.size () + added.size ());
+        std::merge (kept.begin (), kept.end (), added.begin (), first_unconfirmed,
+            std::back_inserter (merged), earlier);
+        for (const tx &x : pending) merged.push_back (x);
+        for (auto x = first_unconfirmed; x != added.end (); x++) merged.push_back (*x);
+
+        Events = std::move (merged);
+        replay (changed);
+        return *this;
+    }
+
+    void history::update (TXDB &txdb) {
+        size_t confirmed = Events.size ();
+        while (confirmed > 0 && Events[confirmed - 1].When == when::unconfirmed ()) confirmed--;
+
+        // re-add unconfirmed txs that have been mined so that they are put where they belong.
+        events mined;
+        for (size_t n = confirmed; n < Events.size (); n++)
+            if (ptr<vertex> v = txdb[Events[n].TXID]; bool (v) && v->confirmed ())
+                for (const record &r : Events[n].Events) mined <<= event {v, r.Point.Index, r.Direction};
+
+        *this <<= mined;
+    }
+
+    void history::replay (size_t from) {
+        size_t c = from / CheckpointInterval;
+
+        account current {};
+        size_t n = 0;
+        if (c < Checkpoints.size ()) {
+            // checkpoints before from are still good.
+            current = Checkpoints[c];
+            n = c * CheckpointInterval;
+            Checkpoints.resize (c);
+        } else {
+            // nothing was changed before the end of the history.
+            current = Account;
+            n = from;
+        }
+
+        for (; n < Events.size (); n++) {
+            if (n % CheckpointInterval == 0) Checkpoints.push_back (current);
+            apply (current, Events[n].Events);
+        }
+
+        Account = current;
+    }
+
+    history::record::record (const event &e) : Point {e.point ()}, Direction {e.Direction}, Value {e.value ()} {
+        if (Direction == direction::in) Reference = Bitcoin::input {e.put ()}.Reference;
+        else Output = Bitcoin::output {e.put ()};
+    }
+
+    event history::record::resolve (TXDB &txdb) const {
+        return event {txdb[Point.Digest], Point.Index, Direction};
+    }
+
+    events history::tx::resolve (TXDB &txdb) const {
+        // all records belong to the same tx.
+        ptr<vertex> v = txdb[TXID];
+        stack<event> x;
+        for (const record &r : Events) x <<= event {v, r.Point.Index, r.Direction};
+        return events (data::reverse (x));
+    }
+
+    void history::apply (account &a, const list<record> &e) {
+        for (const record &current : e)
+            // delete the output from the account
+            if (current.Direction == direction::in) a.erase (current.Reference);
+            else a[current.Point] = current.Output;
     }
 
     history::episode history::get (when from, when to) const {
 
-        when latest = latest_known ();
-        if (to > latest) to = when::infinity ();
+        // unconfirmed txs are always at the end.
+        size_t confirmed = Events.size ();
+        while (confirmed > 0 && Events[confirmed - 1].When == when::unconfirmed ()) confirmed--;
 
-        history ev;
-        stack<tx> h;
-        for (const tx &e : reverse (Events)) {
-            when w = e.When;
-            if (w < from) ev <<= e.Events;
-            else if (w < to) h <<= e;
+        when latest = confirmed == 0 ? when::negative_infinity () : Events[confirmed - 1].When;
+
+        auto before = [] (const tx &e, const when &w) -> bool {
+            return e.When < w;
+        };
+
+        size_t begin = std::lower_bound (Events.begin (), Events.begin () + confirmed, from, before) - Events.begin ();
+        size_t end = to > latest ? Events.size () :
+            std::lower_bound (Events.begin () + begin, Events.begin () + confirmed, to, before) - Events.begin ();
+
+        // replay from the last checkpoint before the range.
+        account a {};
+        size_t n = 0;
+        if (!Checkpoints.empty ()) {
+            size_t c = std::min (begin / CheckpointInterval, Checkpoints.size () - 1);
+            a = Checkpoints[c];
+            n = c * CheckpointInterval;
         }
 
-        return episode {ev.Account, ordered_list<tx> (reverse (h))};
+        for (; n < begin; n++) apply (a, Events[n].Events);
+
+        stack<tx> h;
+        for (size_t i = end; i > begin; i--) h <<= Events[i - 1];
+
+        return episode {a, ordered_list<tx> (h)};
     }
 
     // the latest known timestamp before unconfirmed events.
     when history::latest_known () const {
-        auto e = Events;
-        while (!e.empty ()) {
-            if (e.first ().When != when::unconfirmed ()) return e.first ().When;
-            e = e.rest ();
-        }
+        for (auto e = Events.rbegin (); e != Events.rend (); e++)
+            if (e->When != when::unconfirmed ()) return e->When;
         return when::negative_infinity ();
     }
 }
@@ -0,0 +1,143 @@
+
+#include <Cosmos/ledger.hpp>
+
+namespace Cosmos {
+
+    size_t ledger::update (const history &h, price_data &pd) {
+        // every tx that we have processed has an entry, so if the history has been
+        // rebuilt or had txs inserted into it, we will see that the txids don't match.
+        bool in_sync = Processed == Entries.size () && Processed <= h.Events.size ();
+        for (size_t n = 0; in_sync && n < Processed; n++) if (Entries[n].TXID != h.Events[n].TXID) in_sync = false;
+
+        if (!in_sync) {
+            Lots = {};
+            Entries = {};
+            Processed = 0;
+        }
+
+        // unconfirmed txs are always at the end of the history.
+        size_t end = h.Events.size ();
+        while (end > Processed && h.Events[end - 1].When == when::unconfirmed ()) end--;
+
+        // get all the prices we will need at once.
+        if (end > Processed) pd.prefetch (
+            h.Events[Processed].When.get<Bitcoin::timestamp> (),
+            h.Events[end - 1].When.get<Bitcoin::timestamp> ());
+
+        for (; Processed < end; Processed++) {
+            const history::tx &e = h.Events[Processed];
+            if (!e.When.is<Bitcoin::timestamp> () || e.When == when::unconfirmed ())
+                throw exception {} << "tx " << e.TXID << " in history has no time";
+
+            Bitcoin::timestamp time = e.When.get<Bitcoin::timestamp> ();
+            maybe<double> price = pd.get (time);
+            if (!bool (price)) throw exception {} << "could not get price at " << time;
+
+            entry next {e.TXID, time, *price, {}, 0, {}};
+
+            Bitcoin::satoshi moved {0};
+            Bitcoin::satoshi received {0};
+
+            for (const history::record &r : e.Events)
+                if (r.Direction == direction::in) {
+                    if (auto x = Lots.find (r.Reference); x != Lots.end ()) {
+                        next.Disposed <<= data::entry<Bitcoin::outpoint, lot> {x->first, x->second};
+                        moved += r.Value;
+                        Lots.erase (x);
+                    } else next.Incoming <<= r.Point;
+                } else {
+                    received += r.Value;
+                    Lots[r.Point] = lot {r.Value, time, *price};
+                }
+
+            if (received > moved) next.Income = received - moved;
+
+            Entries.push_back (next);
+        }
+
+        return h.Events.size () - end;
+    }
+
+    namespace {
+
+        JSON write_lot (const ledger::lot &l) {
+            JSON::object_t o;
+            o["value"] = write (l.Value);
+            o["acquired"] = uint32 (l.Acquired);
+            o["price"] = l.Price;
+            return o;
+        }
+
+        ledger::lot read_lot (const JSON &j) {
+            if (!j.is_object ()) throw exception {} << "invalid ledger lot JSON format";
+            return ledger::lot {read_satoshi (j["value"]), Bitcoin::timestamp {uint32 (j["acquired"])}, double (j["price"])};
+        }
+
+        JSON write_entry (const ledger::entry &e) {
+            JSON::object_t o;
+            o["txid"] = write (e.TXID);
+            o["when"] = uint32 (e.When);
+            o["price"] = e.Price;
+            o["income"] = write (e.Income);
+
+            JSON::object_t disposed;
+            for (const auto &[op, l] : e.Disposed) disposed[write (op)] = write_lot (l);
+            o["disposed"] = disposed;
+
+            JSON::array_t incoming;
+            for (const Bitcoin::outpoint &op : e.Incoming) incoming.push_back (write (op));
+            o["incoming"] = incoming;
+
+            return o;
+        }
+
+        ledger::entry read_entry (const JSON &j) {
+            if (!j.is_object ()) throw exception {} << "invalid ledger entry JSON format";
+
+            ledger::entry e {
+                read_TXID (std::string (j["txid"])),
+                Bitcoin::timestamp {uint32 (j["when"])},
+                double (j["price"]), {},
+                read_satoshi (j["income"]), {}};
+
+            for (const auto &[op, l] : j["disposed"].items ())
+                e.Disposed <<= data::entry<Bitcoin::outpoint, ledger::lot> {read_outpoint (op), read_lot (l)};
+
+            for (const auto &op : j["incoming"]) e.Incoming <<= read_outpoint (std::string (op));
+
+            return e;
+        }
+
+    }
+
+    ledger::operator JSON () const {
+        JSON::object_t j;
+        j["processed"] = Processed;
+
+        JSON::object_t lots;
+        for (const auto &[op, l] : Lots) lots[write (op)] = write_lot (l);
+        j["lots"] = lots;
+
+        JSON::array_t entries;
+        entries.reserve (Entries.size ());
+        for (const entry &e : Entries) entries.push_back (write_entry (e));
+        j["entries"] = entries;
+
+        return j;
+    }
+
+    ledger::ledger (const JSON &j) : ledger {} {
+        if (j == JSON (nullptr)) return;
+
+        if (!j.is_object () || !j.contains ("processed") || !j.contains ("lots") || !j.contains ("entries"))
+            throw exception {} << "invalid ledger JSON format";
+
+        Processed = size_t (j["processed"]);
+
+        for (const auto &[op, l] : j["lots"].items ()) Lots[read_outpoint (op)] = read_lot (l);
+
+        Entries.reserve (j["entries"].size ());
+        for (const auto &e : j["entries"]) Entries.push_back (read_entry (e));
+    }
+
+}
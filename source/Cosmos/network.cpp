@@ -42,7 +42,7 @@ namespace Cosmos {
     broadcast_single_result network::broadcast (const extended_transaction &tx) {
 
         std::cout << "attempting to broadcast tx " << tx.id () << std::endl;
-        wait_for_enter ();
+        if (Interactive) wait_for_enter ();
 
         ARC::submit_response response;
         try {
@@ -69,7 +69,7 @@ namespace Cosmos {
 
         std::cout << "attempting to broadcast " << std::endl;
         for (const auto &tx: txs) std::cout << "\t" << tx.id () << std::endl;
-        wait_for_enter ();
+        if (Interactive) wait_for_enter ();
 
         ARC::submit_txs_response response;
         try {
@@ -121,6 +121,30 @@ namespace Cosmos {
         return z.Fees["standard"].MiningFee;
     }
 
+    namespace {
+        // we wait and try again if we are rate limited or if CoinGecko
+        // has a problem, but only a few times. Anything else is an error.
+        net::HTTP::response get_from_CoinGecko (net::HTTP::client_blocking &client, const net::HTTP::request &request) {
+            constexpr uint32 max_attempts = 5;
+            for (uint32 attempt = 1; true; attempt++) {
+
+                auto response = client (request);
+                if (response.Status == net::HTTP::status::ok) return response;
+
+                uint32 status = static_cast<uint32> (response.Status);
+                if (status != 429 && status < 500)
+                    throw exception {} << "could not get prices from CoinGecko: status " << status << "; " << response.Body;
+
+                if (attempt == max_attempts)
+                    throw exception {} << "could not get prices from CoinGecko after " << max_attempts << " attempts: status " << status;
+
+                net::asio::io_context io {};
+                net::asio::steady_timer {io, net::asio::chrono::seconds (30)}.wait ();
+
+            }
+        }
+    }
+
     double network::price (const Bitcoin::timestamp &tm) {
 
         std::tm time (tm);
@@ -135,20 +159,24 @@ namespace Cosmos {
             entry<data::UTF8, data::UTF8> {"localization", "false" }
         });
 
-        // the rate limitation for this call is hard to understand.
-        // If it doesn't work we wait 30 seconds.
-        while (true) {
+        JSON info = JSON::parse (get_from_CoinGecko (CoinGecko, request).Body);
+        return info["market_data"]["current_price"]["usd"];
+    }
 
-            auto response = CoinGecko (request);
-            if (response.Status == net::HTTP::status::ok) {
-                JSON info = JSON::parse (response.Body);
-                return info["market_data"]["current_price"]["usd"];
-            }
+    list<entry<Bitcoin::timestamp, double>> network::price_range (const Bitcoin::timestamp &from, const Bitcoin::timestamp &to) {
 
-            net::asio::io_context io {};
-            net::asio::steady_timer {io, net::asio::chrono::seconds (30)}.wait ();
+        auto request = CoinGecko.REST.GET ("/api/v3/coins/bitcoin-cash-sv/market_chart/range", {
+            entry<data::UTF8, data::UTF8> {"vs_currency", "usd"},
+            entry<data::UTF8, data::UTF8> {"from", std::to_string (uint32 (from))},
+            entry<data::UTF8, data::UTF8> {"to", std::to_string (uint32 (to))}
+        });
 
-        }
+        JSON info = JSON::parse (get_from_CoinGecko (CoinGecko, request).Body);
+        list<entry<Bitcoin::timestamp, double>> prices;
+        // times are given in milliseconds.
+        for (const JSON &p : info["prices"])
+            prices <<= entry<Bitcoin::timestamp, double> {Bitcoin::timestamp {uint32 (uint64 (p[0]) / 1000)}, double (p[1])};
+        return prices;
     }
 
     std::ostream &operator << (std::ostream &o, broadcast_result e) {
@@ -121,6 +121,10 @@ namespace Cosmos {
     }
 
     list<Bitcoin::TXID> whatsonchain::addresses::get_history (const Bitcoin::address& addr) {
+        return get_history (addr, 0);
+    }
+
+    list<Bitcoin::TXID> whatsonchain::addresses::get_history (const Bitcoin::address& addr, uint32 from_height) {
 
         auto request = API.REST.GET ((std::stringstream {} << "/v1/bsv/main/address/" + addr + "/history").str ());
         auto response = API (request);
@@ -137,7 +141,12 @@ namespace Cosmos {
 
             JSON txids_JSON = JSON::parse (response.Body);
 
-            for (const JSON &item : txids_JSON) txids = txids << read_TXID (item ["tx_hash"]);
+            for (const JSON &item : txids_JSON) {
+                // unconfirmed txs have a height of zero or less.
+                int64 height = item.contains ("height") ? int64 (item["height"]) : 0;
+                if (height > 0 && height < from_height) continue;
+                txids = txids << read_TXID (item ["tx_hash"]);
+            }
         } catch (const JSON::exception &exception) {
             throw net::HTTP::exception {request, response, string {"problem reading JSON: "} + string {exception.what ()}};
         }
@@ -230,6 +239,45 @@ namespace Cosmos {
 
     }
 
+    list<whatsonchain::transactions::status> whatsonchain::transactions::get_status (list<Bitcoin::TXID> txids) {
+        // the most txs that whatsonchain will take in a single request.
+        constexpr size_t max_txids = 20;
+
+        list<status> statuses;
+
+        while (data::size (txids) != 0) {
+            JSON::array_t chunk;
+            while (data::size (txids) != 0 && chunk.size () < max_txids) {
+                chunk.push_back (write (data::first (txids)));
+                txids = data::rest (txids);
+            }
+
+            auto request = API.REST.POST ("/v1/bsv/main/txs/status",
+                {{net::HTTP::header::content_type, "application/JSON"}},
+                JSON {{"txids", chunk}}.dump ());
+
+            auto response = API (request);
+
+            if (response.Status != net::HTTP::status::ok)
+                throw net::HTTP::exception {request, response, "response status is not ok"};
+
+            try {
+                for (const JSON &item : JSON::parse (response.Body)) {
+                    status x {read_TXID (item["txid"]), !item.contains ("error"), {}, 0};
+                    if (x.Known && item.contains ("blockhash") && item["blockhash"].is_string ()) {
+                        x.BlockHash = read_TXID (item["blockhash"]);
+                        if (item.contains ("blockheight")) x.BlockHeight = uint32 (item["blockheight"]);
+                    }
+                    statuses <<= x;
+                }
+            } catch (const JSON::exception &exception) {
+                throw net::HTTP::exception {request, response, string {"problem reading JSON: "} + string {exception.what ()}};
+            }
+        }
+
+        return statuses;
+    }
+
     whatsonchain::header whatsonchain::blocks::get_header (const digest256 &hash) {
 
         auto request = API.REST.GET ((std::stringstream {} << "/v1/bsv/main/block/" << write (hash) << "/header").str ());
@@ -281,4 +329,19 @@ namespace Cosmos {
             t, uint32 (h["nonce"])}};
 
     }
+
+    uint32 whatsonchain::blocks::get_height () {
+
+        auto request = API.REST.GET ("/v1/bsv/main/chain/info");
+        auto response = API (request);
+
+        if (response.Status != net::HTTP::status::ok)
+            throw net::HTTP::exception {request, response, "response status is not ok"};
+
+        try {
+            return uint32 (JSON::parse (response.Body)["blocks"]);
+        } catch (const JSON::exception &exception) {
+            throw net::HTTP::exception {request, response, string {"problem reading JSON: "} + string {exception.what ()}};
+        }
+    }
 }
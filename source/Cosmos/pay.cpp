@@ -37,7 +37,7 @@ namespace Cosmos {
                 entry<Bitcoin::address, signing> addr = pay_to_address_signing (d);
                 payments::payment_request pr {addr.Key, x};
                 return payments::new_request {pr,
-                    payments {p.Requests.insert (addr.Key, payments::redeemable {pr, addr.Value.Derivation[0]}), p.Proposals},
+                    payments {p.Requests.insert (addr.Key, payments::redeemable {pr, addr.Value.Derivation[0]}), p.Proposals, p.Unsigned},
                     k.next (k.Receive)};
             }
 
@@ -45,7 +45,7 @@ namespace Cosmos {
                 string ww = string (d.derive ());
                 payments::payment_request pr {ww, x};
                 return payments::new_request {pr,
-                    payments {p.Requests.insert (ww, payments::redeemable {pr, derivation {d.Parent, d.Path}}), p.Proposals},
+                    payments {p.Requests.insert (ww, payments::redeemable {pr, derivation {d.Parent, d.Path}}), p.Proposals, p.Unsigned},
                     k.next (k.Receive)};
             }
 
@@ -54,7 +54,7 @@ namespace Cosmos {
                 string ww = string (ppk.Key);
                 payments::payment_request pr {ww, x};
                 return payments::new_request {pr,
-                    payments {p.Requests.insert (ww, payments::redeemable {pr, ppk.Value.Derivation[0]}), p.Proposals},
+                    payments {p.Requests.insert (ww, payments::redeemable {pr, ppk.Value.Derivation[0]}), p.Proposals, p.Unsigned},
                     k.next (k.Receive)};
             }
 
@@ -137,6 +137,20 @@ namespace Cosmos {
         return o;
     }
 
+    payments::unsigned_offer read_unsigned_offer (const JSON &j) {
+        if (!j.is_object ()) throw exception {} << "invalid unsigned payments offer format";
+        return payments::unsigned_offer {
+            payments::read_payment_request (j["request"]),
+            read_account_diffs (j["diff"])};
+    }
+
+    JSON write_unsigned_offer (const payments::unsigned_offer &p) {
+        JSON::object_t o;
+        o["request"] = payments::write_payment_request (p.Request);
+        o["diff"] = write_account_diffs (p.Diff);
+        return o;
+    }
+
     payments::payments (const JSON &j) {
         if (j == nullptr) return;
         if (!j.is_object ()) throw exception {} << "invalid payments JSON format A";
@@ -152,6 +166,11 @@ namespace Cosmos {
 
         for (const auto &[key, value] : proposals->items ()) Proposals = Proposals.insert (string (key), read_offer (value));
 
+        // this is a new feature.
+        if (auto unsigned_offers = j.find ("unsigned"); unsigned_offers != j.end ())
+            for (const auto &[key, value] : unsigned_offers->items ())
+                Unsigned = Unsigned.insert (string (key), read_unsigned_offer (value));
+
     }
 
     payments::operator JSON () const {
@@ -162,9 +181,13 @@ namespace Cosmos {
         JSON::object_t p;
         for (const auto &e : Proposals) p[std::string (e.Key)] = write_offer (e.Value);
 
+        JSON::object_t u;
+        for (const auto &e : Unsigned) u[std::string (e.Key)] = write_unsigned_offer (e.Value);
+
         JSON::object_t o;
         o["requests"] = r;
         o["proposals"] = p;
+        o["unsigned"] = u;
         return o;
     }
 }
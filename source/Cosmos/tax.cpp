@@ -1,5 +1,7 @@
 
 #include <Cosmos/tax.hpp>
+#include <algorithm>
+#include <ctime>
 
 namespace Cosmos {
 
@@ -12,6 +14,19 @@ namespace Cosmos {
 
         account current_account = events.Account;
 
+        // get all the prices for the episode at once.
+        {
+            maybe<Bitcoin::timestamp> first;
+            Bitcoin::timestamp last {0};
+            for (const history::tx &e : events.History)
+                if (e.When.is<Bitcoin::timestamp> () && e.When != when::unconfirmed ()) {
+                    if (!bool (first)) first = e.When.get<Bitcoin::timestamp> ();
+                    last = e.When.get<Bitcoin::timestamp> ();
+                }
+
+            if (bool (first)) pd->prefetch (*first, last);
+        }
+
         // potential income events.
         list<potential_income> income;
 
@@ -30,13 +45,13 @@ namespace Cosmos {
             Bitcoin::satoshi current_moved {0};
             Bitcoin::satoshi current_income {0};
 
-            for (const event &n : e.Events)
+            for (const history::record &n : e.Events)
                 if (n.Direction == direction::in) {
                     // this is either a potential income or a move event.
-                    auto op = Bitcoin::input {n.put ()}.Reference;
+                    const auto &op = n.Reference;
                     if (auto x = current_account.find (op); x != current_account.end ()) {
                         // this is a move event, which means we have to calculate capital gain.
-                        auto value = n.value ();
+                        auto value = n.Value;
                         current_moved += value;
                         // when was the original output created?
                         Bitcoin::timestamp when = txs[op.Digest]->when ().get<Bitcoin::timestamp> ();
@@ -46,23 +61,87 @@ namespace Cosmos {
                         if (potential.Price < buy_price) {
                             cg.Loss += (buy_price - potential.Price) * double (value);
                         // otherwise it's either a long or a short term capital gain.
-                        } else (n->when ().get<Bitcoin::timestamp> () - when < one_year ? cg.ShortTerm : cg.LongTerm) +=
+                        } else (e.When.get<Bitcoin::timestamp> () - when < one_year ? cg.ShortTerm : cg.LongTerm) +=
                             (potential.Price - buy_price) * double (value);
-                    } else potential.Incoming <<= n;
-                } else current_income += n.value ();
+                    } else potential.Incoming <<= n.Point;
+                } else current_income += n.Value;
 
-            history v {};
-            v.Account = current_account;
-            v <<= e.Events;
+            history::apply (current_account, e.Events);
 
             if (current_income > current_moved)
                 potential.Income = current_income - current_moved;
 
             if (potential.Income > 0) income <<= potential;
-
-            current_account = v.Account;
         }
 
         return {cg, income, current_account};
     }
+
+    namespace {
+        using entries = std::vector<ledger::entry>::const_iterator;
+
+        // the partial result for a period of time. Since every lot knows its
+        // own cost basis, periods do not depend on one another.
+        tax calculate_period (entries begin, entries end) {
+            list<tax::potential_income> income;
+            tax::capital_gain cg;
+
+            for (auto e = begin; e != end; e++) {
+                for (const auto &[_, lot] : e->Disposed) {
+                    double value = double (lot.Value);
+                    if (e->Price < lot.Price) cg.Loss += (lot.Price - e->Price) * value;
+                    else (e->When - lot.Acquired < one_year ? cg.ShortTerm : cg.LongTerm) += (e->Price - lot.Price) * value;
+                }
+
+                if (e->Income > 0) {
+                    tax::potential_income potential;
+                    potential.TXID = e->TXID;
+                    potential.Income = e->Income;
+                    potential.Price = e->Price;
+                    potential.Incoming = e->Incoming;
+                    income <<= potential;
+                }
+            }
+
+            return {cg, income, {}};
+        }
+
+        // months since 1970.
+        uint32 month (const Bitcoin::timestamp &t) {
+            std::time_t x = uint32 (t);
+            std::tm m {};
+            gmtime_r (&x, &m);
+            return uint32 (m.tm_year - 70) * 12 + uint32 (m.tm_mon);
+        }
+    }
+
+    tax tax::calculate (const ledger &l, when from, when to, uint32 threads) {
+        auto before = [] (const ledger::entry &e, const when &w) -> bool {
+            return when {e.When} < w;
+        };
+
+        entries begin = std::lower_bound (l.Entries.begin (), l.Entries.end (), from, before);
+        entries end = std::lower_bound (begin, l.Entries.end (), to, before);
+
+        // divide the range into months.
+        std::vector<entries> periods;
+        for (auto e = begin; e != end; e++)
+            if (periods.empty () || month (e->When) != month (periods.back ()->When)) periods.push_back (e);
+        periods.push_back (end);
+
+        std::vector<tax> partial = parallel_map<tax> (periods.size () - 1, [&periods] (size_t i) -> tax {
+            return calculate_period (periods[i], periods[i + 1]);
+        }, threads);
+
+        // merge in order so that the result does not depend on the number of threads.
+        tax result {};
+        for (const tax &t : partial) {
+            result.CapitalGain.Loss += t.CapitalGain.Loss;
+            result.CapitalGain.ShortTerm += t.CapitalGain.ShortTerm;
+            result.CapitalGain.LongTerm += t.CapitalGain.LongTerm;
+            result.Income = result.Income + t.Income;
+        }
+
+        return result;
+    }
 }
@@ -15,6 +15,30 @@ namespace Cosmos {
         return a;
     }
 
+    account_builder::account_builder (const account &a) : Outputs {} {
+        for (const auto &[key, value] : a) Outputs[key] = value;
+    }
+
+    account_builder &account_builder::operator <<= (const account_diff &d) {
+        // check everything before we change anything.
+        for (const auto &[_, o] : d.Remove) if (!Outputs.contains (o)) throw account::cannot_apply_diff {};
+
+        for (const auto &[_, o] : d.Remove) Outputs.erase (o);
+        for (const auto &e : d.Insert) Outputs[Bitcoin::outpoint {d.TXID, e.Key}] = e.Value;
+        return *this;
+    }
+
+    account_builder &account_builder::operator += (const account &a) {
+        for (const auto &[key, value] : a) Outputs[key] = value;
+        return *this;
+    }
+
+    account account_builder::finalize () const {
+        account a {};
+        for (const auto &[key, value] : Outputs) a = a.insert (key, value);
+        return a;
+    }
+
     redeemable::operator JSON () const {
         JSON::array_t deriv;
 
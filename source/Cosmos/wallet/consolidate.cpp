@@ -0,0 +1,164 @@
+#include <Cosmos/wallet/consolidate.hpp>
+
+namespace Cosmos {
+
+    consolidate::scripts consolidate::select (const account &a) const {
+        auto merge = [] (list<entry<Bitcoin::outpoint, redeemable>> o, list<entry<Bitcoin::outpoint, redeemable>> n)
+            -> list<entry<Bitcoin::outpoint, redeemable>> {
+                return o + n;
+            };
+
+        scripts z;
+
+        // find all outputs that are small enough to consolidate.
+        for (const auto &[key, value] : a)
+            if (value.Prevout.Value < Threshold)
+                z = z.insert (Gigamonkey::SHA2_256 (value.Prevout.Script),
+                    {entry<Bitcoin::outpoint, redeemable> {key, value}}, merge);
+
+        // include the bigger outputs that share a script with a small one.
+        for (const auto &[key, value] : a)
+            if (value.Prevout.Value >= Threshold) {
+                digest256 script_hash = Gigamonkey::SHA2_256 (value.Prevout.Script);
+                if (z.contains (script_hash))
+                    z = z.insert (script_hash, {entry<Bitcoin::outpoint, redeemable> {key, value}}, merge);
+            }
+
+        return z;
+    }
+
+    bool consolidate::fits (const size_estimator &x) const {
+        // 9 is the largest possible size for the number of outputs.
+        return x.size_without_outputs () + 9 + max_outputs (x.Inputs) * size_estimator::P2PKHOutputSize <= MaxTxSize;
+    }
+
+    std::vector<list<entry<Bitcoin::outpoint, redeemable>>> consolidate::pack (const scripts &x) const {
+        std::vector<list<entry<Bitcoin::outpoint, redeemable>>> txs;
+
+        list<entry<Bitcoin::outpoint, redeemable>> current;
+        size_estimator current_size {};
+
+        for (const auto &[script_hash, outputs] : x) {
+            size_estimator script_size {};
+            for (const auto &[_, re] : outputs) script_size.add_input (re);
+
+            // the whole script fits into the current tx.
+            size_estimator combined = current_size;
+            for (const auto &[_, re] : outputs) combined.add_input (re);
+            if (fits (combined)) {
+                current = current + outputs;
+                current_size = combined;
+                continue;
+            }
+
+            if (data::size (current) != 0) txs.push_back (current);
+            current = {};
+            current_size = {};
+
+            // the whole script fits into a new tx.
+            if (fits (script_size)) {
+                current = outputs;
+                current_size = script_size;
+                continue;
+            }
+
+            // this script is too big for one tx, so it is divided between several.
+            for (const entry<Bitcoin::outpoint, redeemable> &e : outputs) {
+                size_estimator next = current_size;
+                next.add_input (e.Value);
+                if (!fits (next)) {
+                    if (data::size (current) == 0)
+                        throw exception {} << "an output cannot fit in a tx of at most " << MaxTxSize << " bytes";
+                    txs.push_back (current);
+                    current = {};
+                    next = size_estimator {};
+                    next.add_input (e.Value);
+                }
+
+                current <<= e;
+                current_size = next;
+            }
+        }
+
+        if (data::size (current) != 0) txs.push_back (current);
+        return txs;
+    }
+
+    consolidate::result consolidate::operator () (const split &s, redeem r, data::crypto::random &rand,
+        keychain k, pubkeys p, address_sequence x, const scripts &selected, double fee_rate, uint32 threads) const {
+
+        // all inputs are likely to have the same parent key, so
+        // we only derive it once.
+        derivation_cache keys {};
+
+        list<std::pair<extended_transaction, account_diff>> txs;
+
+        for (const list<entry<Bitcoin::outpoint, redeemable>> &tx_inputs : pack (selected)) {
+            size_estimator estimate {};
+            std::vector<signer> inputs;
+            inputs.reserve (data::size (tx_inputs));
+            map<Bitcoin::index, Bitcoin::outpoint> remove;
+
+            Bitcoin::index input_index = 0;
+            for (const auto &[op, re] : tx_inputs) {
+                estimate.add_input (re);
+                inputs.push_back (signer {
+                    for_each ([&k, &p, &keys] (const derivation &d) -> Bitcoin::secret {
+                        Bitcoin::secret sec = find_secret (k, p, d, keys);
+                        if (!sec.valid ()) throw exception {} << "could not find secret key for " << d;
+                        return sec;
+                    }, re.Derivation),
+                    Bitcoin::prevout {op, re.Prevout},
+                    re.ExpectedScriptSize,
+                    Bitcoin::input::Finalized,
+                    re.UnlockScriptSoFar});
+                remove = remove.insert (input_index++, op);
+            }
+
+            // the fee for everything but the outputs. The number of outputs is
+            // included with their fees below and in split::values.
+            Bitcoin::satoshi value = estimate.Spent -
+                Bitcoin::satoshi {int64 (std::ceil (fee_rate * estimate.size_without_outputs ()))};
+
+            // the fee for a single output.
+            Bitcoin::satoshi single_output_fee {int64 (std::ceil (fee_rate *
+                (Bitcoin::var_int::size (1) + size_estimator::P2PKHOutputSize)))};
+
+            if (value <= single_output_fee) throw exception {5} << "too few sats to consolidate!";
+
+            // we use the same distribution as split if there is enough value to make
+            // more than one output. Otherwise everything goes into a single output.
+            std::vector<Bitcoin::satoshi> values;
+            if (value - single_output_fee >= s.MinSatsPerOutput + s.MinSatsPerOutput)
+                if (auto v = s.values (rand, value, fee_rate, max_outputs (estimate.Inputs)); bool (v)) values = *v;
+
+            if (values.size () == 0) values.push_back (value - single_output_fee);
+
+            list<redeemable> new_outputs;
+            for (const Bitcoin::satoshi &v : values) {
+                entry<Bitcoin::address, signing> next_address = pay_to_address_signing (x.last ());
+                x = x.next ();
+                new_outputs <<= redeemable {Bitcoin::output {v, pay_to_address::script (next_address.Key.digest ())}, next_address.Value};
+            }
+
+            new_outputs = shuffle (new_outputs, rand);
+
+            extended_transaction completed = signable_transaction {1, inputs,
+                for_each ([] (const redeemable &re) -> Bitcoin::output {
+                    return re.Prevout;
+                }, new_outputs), 0}.sign (r, threads);
+
+            if (!completed.valid ()) throw exception {6} << "invalid tx generated";
+
+            account_diff diff {completed.id (), {}, remove};
+
+            Bitcoin::index output_index = 0;
+            for (const redeemable &o : new_outputs) diff.Insert = diff.Insert.insert (output_index++, o);
+
+            txs <<= {completed, diff};
+        }
+
+        return result {txs, x.Last};
+    }
+
+}
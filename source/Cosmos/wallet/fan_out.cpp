@@ -0,0 +1,187 @@
+#include <Cosmos/wallet/fan_out.hpp>
+#include <deque>
+
+namespace Cosmos {
+
+    uint32 fan_out::node::transactions () const {
+        uint32 n = 1;
+        for (const node &c : Children) n += c.transactions ();
+        return n;
+    }
+
+    uint32 fan_out::node::leaves () const {
+        uint32 n = Leaves.size ();
+        for (const node &c : Children) n += c.leaves ();
+        return n;
+    }
+
+    uint32 fan_out::node::addresses () const {
+        uint32 n = outputs ();
+        for (const node &c : Children) n += c.addresses ();
+        return n;
+    }
+
+    Bitcoin::satoshi fan_out::node::fees () const {
+        Bitcoin::satoshi f = Fee;
+        for (const node &c : Children) f += c.fees ();
+        return f;
+    }
+
+    uint32 fan_out::max_outputs (uint32 num_inputs, uint64 inputs_size) const {
+        // 9 is the largest possible size for the number of outputs.
+        uint64 fixed_size = size_without_outputs (num_inputs, inputs_size) + 9;
+        if (fixed_size + size_estimator::P2PKHOutputSize > MaxTxSize)
+            throw exception {} << "a tx with " << num_inputs << " inputs cannot be smaller than " << MaxTxSize << " bytes";
+        return std::min<uint64> (MaxOutputsPerTx, (MaxTxSize - fixed_size) / size_estimator::P2PKHOutputSize);
+    }
+
+    fan_out::node fan_out::plan (const split &s, data::crypto::random &r, Bitcoin::satoshi value,
+        uint32 num_inputs, uint64 inputs_size, double fee_rate) const {
+
+        uint32 max = max_outputs (num_inputs, inputs_size);
+        if (max < 2) throw exception {} << "cannot fan out with fewer than two outputs per tx";
+
+        Bitcoin::satoshi fixed_fee {int64 (ceil (fee_rate * size_without_outputs (num_inputs, inputs_size)))};
+        if (value <= fixed_fee) throw exception {5} << "too few sats to split!";
+
+        // we only fill a tx to 90% of its capacity on average so
+        // that random variation rarely requires an extra level.
+        double leaf_capacity = .9 * max * s.MeanSatsPerOutput;
+
+        if (double (int64 (value)) <= leaf_capacity)
+            if (auto leaves = s.values (r, value - fixed_fee, fee_rate, max); bool (leaves)) {
+                Bitcoin::satoshi sent {0};
+                for (const Bitcoin::satoshi &v : *leaves) sent += v;
+                return node {value, *leaves, {}, value - sent, random_ordering (leaves->size (), r)};
+            }
+
+        // too much for one tx, so we make intermediate outputs, each of which is split by another tx.
+        uint32 branches = std::clamp<uint32> (uint32 (ceil (double (int64 (value)) / leaf_capacity)), 2, max);
+
+        Bitcoin::satoshi fee = fixed_fee + Bitcoin::satoshi {int64 (ceil (fee_rate *
+            (Bitcoin::var_int::size (branches) + branches * size_estimator::P2PKHOutputSize)))};
+
+        int64 spendable = int64 (value - fee);
+        if (spendable / branches <= int64 (s.MinSatsPerOutput)) throw exception {5} << "too few sats to split!";
+
+        std::vector<node> children;
+        children.reserve (branches);
+        for (uint32 i = 0; i < branches; i++) children.push_back (plan (s, r,
+            Bitcoin::satoshi {spendable / branches + (i == 0 ? spendable % branches : 0)},
+            1, size_estimator::p2pkh_input_size (), fee_rate));
+
+        return node {value, {}, children, fee, random_ordering (branches, r)};
+    }
+
+    fan_out::result fan_out::build (const node &root, redeem r,
+        keychain k, pubkeys p, address_sequence x, list<entry<Bitcoin::outpoint, redeemable>> selected, uint32 threads) const {
+
+        // all inputs are likely to have the same parent key, so
+        // we only derive it once.
+        derivation_cache keys {};
+
+        // a tx whose inputs are known but which has not been built yet.
+        struct pending {
+            const node *Node;
+            std::vector<signer> Inputs;
+            map<Bitcoin::index, Bitcoin::outpoint> Remove;
+        };
+
+        // an output along with the tx that will spend it, if there is one.
+        struct planned_output {
+            redeemable Output {};
+            const node *Child {nullptr};
+        };
+
+        std::deque<pending> queue;
+
+        {
+            pending first_tx {&root, {}, {}};
+            Bitcoin::index input_index = 0;
+            for (const auto &[op, re] : selected) {
+                first_tx.Inputs.push_back (signer {
+                    for_each ([&k, &p, &keys] (const derivation &d) -> Bitcoin::secret {
+                        Bitcoin::secret sec = find_secret (k, p, d, keys);
+                        if (!sec.valid ()) throw exception {} << "could not find secret key for " << d;
+                        return sec;
+                    }, re.Derivation),
+                    Bitcoin::prevout {op, re.Prevout},
+                    re.ExpectedScriptSize,
+                    Bitcoin::input::Finalized,
+                    re.UnlockScriptSoFar});
+                first_tx.Remove = first_tx.Remove.insert (input_index++, op);
+            }
+
+            queue.push_back (first_tx);
+        }
+
+        auto new_output = [&x] (Bitcoin::satoshi value) -> redeemable {
+            entry<Bitcoin::address, signing> next_address = pay_to_address_signing (x.last ());
+            x = x.next ();
+            return redeemable {Bitcoin::output {value, pay_to_address::script (next_address.Key.digest ())}, next_address.Value};
+        };
+
+        list<std::pair<extended_transaction, account_diff>> txs;
+
+        // breadth first, so that every tx comes after the tx that it spends.
+        while (!queue.empty ()) {
+            pending next = queue.front ();
+            queue.pop_front ();
+
+            std::vector<planned_output> outputs (next.Node->outputs ());
+            {
+                size_t i = 0;
+                for (const node &child : next.Node->Children)
+                    outputs[next.Node->Ordering[i++]] = planned_output {new_output (child.Value), &child};
+                for (const Bitcoin::satoshi &leaf : next.Node->Leaves)
+                    outputs[next.Node->Ordering[i++]] = planned_output {new_output (leaf), nullptr};
+            }
+
+            list<Bitcoin::output> tx_outputs;
+            for (const planned_output &o : outputs) tx_outputs <<= o.Output.Prevout;
+
+            extended_transaction completed = signable_transaction {1, next.Inputs, tx_outputs, 0}.sign (r, threads);
+
+            if (!completed.valid ()) throw exception {6} << "invalid tx generated";
+
+            account_diff diff {completed.id (), {}, next.Remove};
+
+            Bitcoin::index output_index = 0;
+            for (const planned_output &o : outputs) {
+                diff.Insert = diff.Insert.insert (output_index, o.Output);
+
+                if (o.Child != nullptr) {
+                    Bitcoin::outpoint op {diff.TXID, output_index};
+                    auto d = first (o.Output.Derivation);
+                    Bitcoin::secret sec = find_secret (k, p, d, keys);
+                    if (!sec.valid ()) throw exception {} << "could not find secret key for " << d;
+
+                    queue.push_back (pending {o.Child,
+                        {signer {{sec}, Bitcoin::prevout {op, o.Output.Prevout}, o.Output.ExpectedScriptSize}},
+                        map<Bitcoin::index, Bitcoin::outpoint> {}.insert (0, op)});
+                }
+
+                output_index++;
+            }
+
+            txs <<= {completed, diff};
+        }
+
+        return result {txs, x.Last};
+    }
+
+    fan_out::result fan_out::operator () (const split &s, redeem r, data::crypto::random &rand, keychain k, pubkeys p,
+        address_sequence x, list<entry<Bitcoin::outpoint, redeemable>> selected, double fee_rate) const {
+
+        size_estimator estimate {};
+        for (const auto &[_, re] : selected) estimate.add_input (re);
+
+        node tree = plan (s, rand, estimate.Spent, estimate.Inputs, estimate.InputsSize, fee_rate);
+
+        std::cout << "planned " << tree.transactions () << " transactions making " << tree.leaves () <<
+            " outputs with " << tree.fees () << " in fees" << std::endl;
+
+        return build (tree, r, k, p, x, selected);
+    }
+
+}
@@ -0,0 +1,36 @@
+
+#include <Cosmos/wallet/keys/pool.hpp>
+
+namespace Cosmos {
+
+    address_pool::address_pool (const addresses &a, uint32 look_ahead) : address_pool {look_ahead} {
+        extend (a);
+    }
+
+    void address_pool::extend (const addresses &a) {
+        for (const auto &[name, sequence] : a.Sequences) extend (name, sequence);
+    }
+
+    void address_pool::extend (const string &name, const address_sequence &x, uint32 next) {
+        uint32 begin = end (name);
+        uint32 new_end = next + LookAhead;
+        if (new_end <= begin) return;
+
+        Sequences[name] = x;
+        End[name] = new_end;
+
+        for (const derived_address &d : x.derive_range (begin, new_end - begin)) {
+            Index[Gigamonkey::SHA2_256 (d.Script)] = position {name, d.Index, false};
+            Index[Gigamonkey::SHA2_256 (pay_to_pubkey::script (Bitcoin::pubkey {d.Pubkey.Pubkey}))] = position {name, d.Index, true};
+        }
+    }
+
+    signing address_pool::signing_at (const position &p) const {
+        const address_sequence &x = Sequences.at (p.Sequence);
+        derivation d {x.Parent, x.Path << p.Index};
+        return p.PayToPubkey ?
+            Cosmos::signing {{d}, pay_to_pubkey::redeem_expected_size ()}:
+            Cosmos::signing {{d}, pay_to_address::redeem_expected_size ()};
+    }
+
+}
@@ -20,6 +20,68 @@ namespace Cosmos {
         *this = keychain {db};
     }
 
+    namespace {
+        // volatile so that the compiler does not remove writes to memory that is about to be freed.
+        void wipe (byte *b, size_t size) {
+            volatile byte *v = b;
+            while (size-- > 0) *v++ = 0;
+        }
+
+        void wipe (HD::BIP_32::secret &x) {
+            wipe (x.Secret.Value.data (), x.Secret.Value.size ());
+            wipe (x.ChainCode.data (), x.ChainCode.size ());
+        }
+    }
+
+    HD::BIP_32::secret derivation_cache::derive (const keychain &k, const pubkey &parent, const HD::BIP_32::path &path) {
+        Lookups++;
+
+        std::vector<uint32> p;
+        for (uint32 u : path) p.push_back (u);
+
+        // find the longest prefix of the path that has already been derived.
+        size_t n = p.size ();
+        HD::BIP_32::secret x {};
+        while (true) {
+            auto known = Keys.find ({parent, std::vector<uint32> (p.begin (), p.begin () + n)});
+            if (known != Keys.end ()) {
+                x = known->second;
+                break;
+            }
+
+            if (n == 0) {
+                const auto *v = k.contains (parent);
+                if (!bool (v)) return HD::BIP_32::secret {};
+                x = HD::BIP_32::secret {*v};
+                if (!x.valid ()) return HD::BIP_32::secret {};
+                Keys[{parent, {}}] = x;
+                break;
+            }
+
+            n--;
+        }
+
+        if (n == p.size ()) Hits++;
+
+        // derive the rest of the path one step at a time, remembering each step.
+        for (; n < p.size (); n++) {
+            x = x.derive (HD::BIP_32::path {p[n]});
+            Derivations++;
+            Keys[{parent, std::vector<uint32> (p.begin (), p.begin () + n + 1)}] = x;
+        }
+
+        return x;
+    }
+
+    void derivation_cache::clear () {
+        for (auto &[_, x] : Keys) wipe (x);
+        Keys.clear ();
+    }
+
+    derivation_cache::~derivation_cache () {
+        clear ();
+    }
+
     keychain::operator JSON () const {
         JSON::object_t db {};
         for (const data::entry<pubkey, secret> &e : *this)
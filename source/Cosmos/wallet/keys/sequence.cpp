@@ -12,6 +12,13 @@ namespace Cosmos {
         Last = j["last"];
     }
 
+    cross<derived_address> address_sequence::derive_range (uint32 first, uint32 count) const {
+        const HD::BIP_32::pubkey &n = node ();
+        cross<derived_address> x (count);
+        for (uint32 i = 0; i < count; i++) x[i] = derived_address {first + i, n.derive (HD::BIP_32::path {first + i})};
+        return x;
+    }
+
     address_sequence::operator JSON () const {
         JSON::object_t x {};
         x["parent"] = Parent.write ();
@@ -0,0 +1,181 @@
+#include <Cosmos/wallet/wallet.hpp>
+
+namespace Cosmos::nosig {
+
+    // a minimal push of some data onto the stack.
+    void write_push (std::vector<byte> &script, const bytes &data) {
+        size_t size = data.size ();
+        if (size < 0x4c) script.push_back (static_cast<byte> (size));
+        else if (size <= 0xff) {
+            script.push_back (0x4c);
+            script.push_back (static_cast<byte> (size));
+        } else if (size <= 0xffff) {
+            script.push_back (0x4d);
+            script.push_back (static_cast<byte> (size));
+            script.push_back (static_cast<byte> (size >> 8));
+        } else throw exception {} << "data too big to push: " << size << " bytes";
+        script.insert (script.end (), data.begin (), data.end ());
+    }
+
+    bytes push (const bytes &data) {
+        std::vector<byte> script;
+        write_push (script, data);
+        bytes b (script.size ());
+        std::copy (script.begin (), script.end (), b.begin ());
+        return b;
+    }
+
+    sigop::sigop (const JSON &j) {
+        if (!j.is_object () || !j.contains ("directive") || !j.contains ("derivation"))
+            throw exception {} << "invalid sigop JSON format";
+        Directive = static_cast<Bitcoin::sighash::directive> (uint32 (j["directive"]));
+        Derivation = derivation {j["derivation"]};
+    }
+
+    sigop::operator JSON () const {
+        JSON::object_t j;
+        j["directive"] = uint32 (Directive);
+        j["derivation"] = JSON (Derivation);
+        return j;
+    }
+
+    input::input (const JSON &j) : Bitcoin::incomplete::input {}, Script {}, Prevout {} {
+        if (!j.is_object ()) throw exception {} << "invalid unsigned input JSON format";
+
+        this->Reference = read_outpoint (std::string (j["reference"]));
+        this->Sequence = uint32 (j["sequence"]);
+        Prevout = read_output (j["prevout"]);
+
+        const JSON &x = j["script"];
+        if (!x.is_array ()) throw exception {} << "invalid unsigned script JSON format";
+        for (const JSON &element : x)
+            if (element.is_string ()) {
+                maybe<bytes> b = encoding::hex::read (std::string (element));
+                if (!bool (b)) throw exception {} << "could not read hex value from " << element;
+                Script <<= either<bytes, sigop> {*b};
+            } else Script <<= either<bytes, sigop> {sigop {element}};
+    }
+
+    input::operator JSON () const {
+        JSON::array_t x;
+        for (const auto &element : Script)
+            if (const bytes *b = std::get_if<bytes> (&element); b != nullptr)
+                x.push_back (encoding::hex::write (*b));
+            else x.push_back (JSON (std::get<sigop> (element)));
+
+        JSON::object_t j;
+        j["reference"] = write (this->Reference);
+        j["sequence"] = uint32 (this->Sequence);
+        j["prevout"] = write (Prevout);
+        j["script"] = x;
+        return j;
+    }
+
+    transaction::transaction (const JSON &j) : Version {}, Inputs {}, Outputs {}, LockTime {} {
+        if (!j.is_object () || !j.contains ("inputs") || !j.contains ("outputs"))
+            throw exception {} << "invalid unsigned transaction JSON format";
+
+        Version = int32 (j["version"]);
+        LockTime = uint32 (j["locktime"]);
+        for (const JSON &in : j["inputs"]) Inputs <<= input {in};
+        for (const JSON &out : j["outputs"]) Outputs <<= read_output (out);
+    }
+
+    transaction::operator JSON () const {
+        JSON::array_t inputs;
+        for (const input &in : Inputs) inputs.push_back (JSON (in));
+
+        JSON::array_t outputs;
+        for (const Bitcoin::output &out : Outputs) outputs.push_back (write (out));
+
+        JSON::object_t j;
+        j["version"] = int32 (Version);
+        j["inputs"] = inputs;
+        j["outputs"] = outputs;
+        j["locktime"] = uint32 (LockTime);
+        return j;
+    }
+
+    Bitcoin::incomplete::transaction transaction::incomplete () const {
+        return Bitcoin::incomplete::transaction {Version,
+            for_each ([] (const input &in) -> Bitcoin::incomplete::input {
+                return Bitcoin::incomplete::input (in);
+            }, Inputs), Outputs, LockTime};
+    }
+
+    extended_transaction transaction::sign (const keychain &k, const pubkeys &p, derivation_cache &c, uint32 threads) const {
+        std::vector<const input *> inputs;
+        inputs.reserve (Inputs.size ());
+
+        // derive all keys first, since the cache can only be used from one thread.
+        std::vector<std::vector<Bitcoin::secret>> keys;
+        keys.reserve (Inputs.size ());
+
+        for (const input &in : Inputs) {
+            inputs.push_back (&in);
+            std::vector<Bitcoin::secret> input_keys;
+            for (const auto &element : in.Script)
+                if (const sigop *x = std::get_if<sigop> (&element); x != nullptr) {
+                    Bitcoin::secret sec = find_secret (k, p, x->Derivation, c);
+                    if (!sec.valid ()) throw exception {} << "could not find secret key for " << x->Derivation;
+                    input_keys.push_back (sec);
+                }
+            keys.push_back (input_keys);
+        }
+
+        // the parts of the sighash preimage that every input shares are computed once.
+        sighash_context context {incomplete ()};
+
+        std::vector<bytes> scripts = parallel_map<bytes> (inputs.size (), [&inputs, &keys, &context] (size_t i) -> bytes {
+            const input &in = *inputs[i];
+            std::vector<byte> script;
+            size_t key_index = 0;
+            for (const auto &element : in.Script)
+                if (const bytes *b = std::get_if<bytes> (&element); b != nullptr)
+                    script.insert (script.end (), b->begin (), b->end ());
+                else write_push (script, bytes (context.sign (keys[i][key_index++],
+                    static_cast<Bitcoin::index> (i), in.Prevout.Value, in.Prevout.Script,
+                    std::get<sigop> (element).Directive)));
+
+            bytes b (script.size ());
+            std::copy (script.begin (), script.end (), b.begin ());
+            return b;
+        }, threads);
+
+        list<Gigamonkey::extended::input> signed_inputs;
+        for (size_t i = 0; i < inputs.size (); i++)
+            signed_inputs <<= Gigamonkey::extended::input {inputs[i]->Prevout,
+                Bitcoin::input {inputs[i]->Reference, scripts[i], inputs[i]->Sequence}};
+
+        return extended_transaction {Version, signed_inputs, Outputs, LockTime};
+    }
+
+    script p2pkh_and_p2pk (const redeemable &re) {
+        if (data::size (re.Derivation) != 1) throw exception {} << "p2pkh_and_p2pk can only redeem outputs with one key";
+        const derivation &d = first (re.Derivation);
+        const bytes &prevout = re.Prevout.Script;
+
+        script x {};
+        if (re.UnlockScriptSoFar.size () != 0) x <<= either<bytes, sigop> {re.UnlockScriptSoFar};
+
+        // <pubkey> OP_CHECKSIG
+        if ((prevout.size () == 35 || prevout.size () == 67) &&
+            prevout[0] == prevout.size () - 2 && prevout[prevout.size () - 1] == 0xac)
+            return x << either<bytes, sigop> {sigop {d}};
+
+        // OP_DUP OP_HASH160 <20 bytes> OP_EQUALVERIFY OP_CHECKSIG
+        if (prevout.size () == 25 && prevout[0] == 0x76 && prevout[1] == 0xa9 &&
+            prevout[2] == 0x14 && prevout[23] == 0x88 && prevout[24] == 0xac) {
+            // we can get the pubkey without the secret key since the derivation is not hardened.
+            Bitcoin::pubkey pk;
+            if (HD::BIP_32::pubkey parent {d.Parent}; parent.valid ()) pk = Bitcoin::pubkey {parent.derive (d.Path).Pubkey};
+            else if (Bitcoin::pubkey parent {d.Parent}; parent.valid () && data::size (d.Path) == 0) pk = parent;
+            else throw exception {} << "cannot derive pubkey for " << d;
+
+            return x << either<bytes, sigop> {sigop {d}} << either<bytes, sigop> {push (pk)};
+        }
+
+        throw exception {} << "p2pkh_and_p2pk cannot redeem script " << encoding::hex::write (prevout);
+    }
+
+}
@@ -1,94 +1,378 @@
 
 #include <Cosmos/wallet/restore.hpp>
+#include <Cosmos/parallel.hpp>
+#include <future>
+#include <mutex>
 
 namespace Cosmos {
 
-    restore::restored restore::operator () (
-        TXDB &txdb,
-        address_sequence m) {
+    restore_progress::sequence::sequence (const JSON &j) {
+        if (!j.is_object ()) throw exception {} << "invalid restore progress JSON format";
+        First = uint32 (j["first"]);
+        Checked = uint32 (j["checked"]);
+        Last = uint32 (j["last"]);
+        Height = uint32 (j["height"]);
+        Done = bool (j["done"]);
+        // progress saved before backfilling was possible always has the whole history.
+        Backfilled = j.contains ("backfilled") ? uint32 (j["backfilled"]) : Checked;
+        HistoryComplete = j.contains ("history_complete") ? bool (j["history_complete"]) : Done;
+    }
+
+    restore_progress::sequence::operator JSON () const {
+        JSON::object_t j;
+        j["first"] = First;
+        j["checked"] = Checked;
+        j["last"] = Last;
+        j["height"] = Height;
+        j["done"] = Done;
+        j["backfilled"] = Backfilled;
+        j["history_complete"] = HistoryComplete;
+        return j;
+    }
+
+    restore_progress::restore_progress (const JSON &j) : Sequences {} {
+        if (j == JSON (nullptr)) return;
+        if (!j.is_object () || !j.contains ("sequences")) throw exception {} << "invalid restore progress JSON format";
+        for (const auto &[name, x] : j["sequences"].items ()) Sequences[name] = sequence {x};
+    }
+
+    restore_progress::operator JSON () const {
+        JSON::object_t sequences;
+        for (const auto &[name, x] : Sequences) sequences[name] = JSON (x);
+        JSON::object_t j;
+        j["sequences"] = sequences;
+        return j;
+    }
+
+    namespace {
+        // an address whose history is to be downloaded.
+        struct restore_job {
+            // index of the sequence that the address belongs to.
+            size_t Scan;
+            derived_address Address;
+        };
+
+        // the history of an address along with the txs in it that we did not have yet.
+        struct restore_download {
+            list<Bitcoin::TXID> History;
+            // only downloaded if we are restoring unspent outputs only.
+            list<whatsonchain::UTXO> Unspent;
+            list<cached_remote_TXDB::downloaded> Transactions;
+        };
+
+        // the progress of the restore of one sequence.
+        struct restore_scan {
+            string Name;
+            address_sequence Sequence;
+            uint32 First;
+            // the first address that has not been derived yet.
+            uint32 Next;
+            // number of unused addresses in a row.
+            uint32 Unused;
+            // last key used (+1)
+            uint32 Last;
+            // the height to be recorded in the progress.
+            uint32 Height;
+            // if not zero, only look for txs since this height.
+            uint32 Since;
+            events History;
+            // outputs to our addresses and the outputs of ours that were spent.
+            std::map<Bitcoin::outpoint, redeemable> Received;
+            std::map<Bitcoin::outpoint, inpoint> Spent;
+            bool Done;
+        };
+    }
+
+    restore::result restore::operator () (cached_remote_TXDB &txdb,
+        map<string, address_sequence> sequences, const restore_progress &progress, uint32 threads) const {
+        return scan (txdb, sequences, progress, threads, mode::history);
+    }
+
+    restore::result restore::unspent (cached_remote_TXDB &txdb,
+        map<string, address_sequence> sequences, const restore_progress &progress, uint32 threads) const {
+        return scan (txdb, sequences, progress, threads, mode::unspent);
+    }
+
+    restore::result restore::rescan (cached_remote_TXDB &txdb,
+        map<string, address_sequence> sequences, const restore_progress &progress, uint32 threads) const {
+        return scan (txdb, sequences, progress, threads, mode::rescan);
+    }
+
+    restore::result restore::backfill (cached_remote_TXDB &txdb,
+        map<string, address_sequence> sequences, const restore_progress &progress, uint32 threads) const {
+        return scan (txdb, sequences, progress, threads, mode::backfill);
+    }
+
+    restore::result restore::scan (cached_remote_TXDB &txdb,
+        map<string, address_sequence> sequences, const restore_progress &previous, uint32 threads, mode m) const {
 
         if (CheckSubKeys) throw exception {} << "TODO: option CheckSubKeys enabled but not implemented.";
+        if (threads < 1) threads = 1;
 
-        address_sequence last = m;
-        uint32 last_used = 0;
+        result r {{}, previous, {}};
 
-        events v {};
-        std::map<Bitcoin::TXID, map<Bitcoin::index, redeemable>> a {};
+        // we record the height before we start so that a later
+        // rescan cannot miss anything that happens during this one.
+        uint32 height = txdb.Net.WhatsOnChain.block ().get_height ();
 
-        auto expected_p2pkh_size = pay_to_address::redeem_expected_size (true);
+        std::vector<restore_scan> scans;
+        for (const auto &[name, sequence] : sequences) {
+            restore_scan scan {name, sequence, sequence.Last, sequence.Last, 0, sequence.Last, height, 0, {}, {}, {}, false};
+            auto p = previous.Sequences.find (name);
 
-        Bitcoin::satoshi total_in_wallet = 0;
-        Bitcoin::satoshi total_received = 0;
-        Bitcoin::satoshi total_spent = 0;
+            if (m == mode::rescan) {
+                // only sequences that have been completely restored can be rescanned.
+                if (p == previous.Sequences.end () || !p->second.Done) continue;
+                scan.First = scan.Next = p->second.First;
+                scan.Last = std::max (p->second.Last, sequence.Last);
+                scan.Since = p->second.Height;
+            } else if (m == mode::backfill) {
+                // we already know which addresses have been used, so we
+                // go over them from where we left off and then stop.
+                if (p == previous.Sequences.end () || !p->second.Done || p->second.HistoryComplete) continue;
+                scan.First = p->second.First;
+                scan.Next = std::max (p->second.Backfilled, p->second.First);
+                scan.Last = p->second.Last;
+                scan.Height = p->second.Height;
 
-        while (true) {
-            // generate next address
-            entry<Bitcoin::address, signing> next = pay_to_address_signing (m.last ());
-            const Bitcoin::address &new_addr = next.Key;
+                if (scan.Next >= scan.Last) {
+                    r.Progress.Sequences[name].HistoryComplete = true;
+                    continue;
+                }
+            } else if (p != previous.Sequences.end ()) {
+                if (p->second.Done) continue;
+                // continue where we left off.
+                scan.First = p->second.First;
+                scan.Next = p->second.Checked;
+                scan.Last = p->second.Last;
+                scan.Unused = p->second.Checked - p->second.Last;
+                scan.Height = p->second.Height;
+            }
 
-            std::cout << "  recovering address " << m.Last << ": " << new_addr << std::endl;
+            // derive the parent of each sequence here so that it is not derived on several
+            // threads. The copy that the threads use shares the derived node.
+            scan.Sequence.node ();
+            scans.push_back (scan);
+        }
 
-            m = m.next ();
+        // stage 1: derive the next window of every sequence that is not done.
+        auto derive = [this, &scans, m] () -> std::vector<restore_job> {
+            std::vector<size_t> active;
+            for (size_t i = 0; i < scans.size (); i++) if (!scans[i].Done) active.push_back (i);
 
-            // get all txs relating to this address.
-            // TODO there is a potential problem here because we assume
-            // that if the address is known locally at all, then we know
-            // about all usages of it, which is not neccessarily true.
-            events ev = txdb.by_address (new_addr);
-            std::cout << "  found " << ev.size () << " events for address " << new_addr << std::endl;
+            // in a backfill, we don't look past the last address that was used.
+            auto window = [this, m] (const restore_scan &scan) -> uint32 {
+                return m == mode::backfill ? std::min (MaxLookAhead + 1, scan.Last - scan.Next) : MaxLookAhead + 1;
+            };
 
-            if (ev.size () == 0) {
-                if (last_used == MaxLookAhead) break;
+            std::vector<cross<derived_address>> windows = parallel_map<cross<derived_address>> (active.size (),
+                [&scans, &active, &window] (size_t i) -> cross<derived_address> {
+                    const restore_scan &scan = scans[active[i]];
+                    return scan.Sequence.derive_range (scan.Next, window (scan));
+                });
 
-                last_used++;
-                continue;
+            std::vector<restore_job> jobs;
+            for (size_t i = 0; i < active.size (); i++) {
+                scans[active[i]].Next += window (scans[active[i]]);
+                for (const derived_address &a : windows[i]) jobs.push_back (restore_job {active[i], a});
             }
 
-            last_used = 0;
-            last = m;
-
-            v = v + ev;
-
-            Bitcoin::satoshi in_wallet = 0;
-            Bitcoin::satoshi received = 0;
-            Bitcoin::satoshi spent = 0;
-
-            for (const auto &e : ev) {
-                Bitcoin::satoshi value = e.value ();
-                std::cout << "    ";
-                if (e.Direction == direction::out) {
-                    std::cout << "received";
-                    received += value;
-                    in_wallet += value;
-                } else {
-                    std::cout << "spent";
-                    spent += value;
-                    in_wallet -= value;
+            return jobs;
+        };
+
+        // the local database is read by the download threads and written by this one.
+        std::mutex local_mutex;
+
+        // each thread has its own client with its share of the rate limit.
+        std::vector<ptr<whatsonchain>> clients;
+        for (uint32 t = 0; t < threads; t++)
+            clients.push_back (std::make_shared<whatsonchain> (txdb.Net.SSL, tools::rate_limiter {1, 1}));
+
+        // stage 2: download the histories of a window of addresses and the txs in them that we don't have.
+        // If we only want unspent outputs, the history is still needed to know whether an address has
+        // been used, but we only download the txs that contain unspent outputs.
+        auto download = [&txdb, &local_mutex, &clients, &scans, threads, m]
+            (std::vector<restore_job> jobs) -> std::vector<restore_download> {
+            // thread t takes every address whose index is t modulo the number of threads.
+            std::vector<std::vector<restore_download>> parts = parallel_map<std::vector<restore_download>> (threads,
+                [&txdb, &local_mutex, &clients, &scans, &jobs, threads, m] (size_t t) -> std::vector<restore_download> {
+                    whatsonchain &API = *clients[t];
+                    std::vector<restore_download> part;
+                    for (size_t j = t; j < jobs.size (); j += threads) {
+                        const Bitcoin::address &addr = jobs[j].Address.Address;
+                        uint32 since = scans[jobs[j].Scan].Since;
+                        restore_download d {since > 0 ? API.address ().get_history (addr, since) :
+                            API.address ().get_history (addr), {}, {}};
+
+                        // in a rescan, txs that we already have are not new.
+                        if (m == mode::rescan) {
+                            list<Bitcoin::TXID> fresh;
+                            for (const Bitcoin::TXID &txid : d.History) {
+                                std::lock_guard<std::mutex> lock (local_mutex);
+                                if (!txdb.Local.transaction (txid).valid ()) fresh <<= txid;
+                            }
+                            d.History = fresh;
+                        }
+
+                        list<Bitcoin::TXID> needed = d.History;
+                        if (m == mode::unspent && data::size (d.History) != 0) {
+                            d.Unspent = API.address ().get_unspent (addr);
+                            needed = {};
+                            for (const whatsonchain::UTXO &u : d.Unspent) {
+                                bool duplicate = false;
+                                for (const Bitcoin::TXID &txid : needed) if (txid == u.Outpoint.Digest) duplicate = true;
+                                if (!duplicate) needed <<= u.Outpoint.Digest;
+                            }
+                        }
+
+                        for (const Bitcoin::TXID &txid : needed) {
+                            {
+                                std::lock_guard<std::mutex> lock (local_mutex);
+                                auto known = txdb.Local.transaction (txid);
+                                if (known.valid () && known.confirmed ()) continue;
+                            }
+
+                            d.Transactions <<= cached_remote_TXDB::download (API, txid);
+                        }
+                        part.push_back (d);
+                    }
+                    return part;
+                }, threads);
+
+            std::vector<restore_download> downloaded (jobs.size ());
+            for (size_t t = 0; t < threads; t++)
+                for (size_t k = 0; k < parts[t].size (); k++) downloaded[t + k * threads] = parts[t][k];
+            return downloaded;
+        };
+
+        // if anything goes wrong, we keep what we have so far so that it can be saved.
+        try {
+            std::vector<restore_job> jobs = derive ();
+            std::future<std::vector<restore_download>> pending = std::async (std::launch::async, download, jobs);
+
+            while (jobs.size () > 0) {
+                std::vector<restore_download> downloaded = pending.get ();
+                std::vector<restore_job> current = jobs;
+
+                // start on the next window while this one is imported. Whatever is downloaded
+                // for sequences that turn out to be done with this window is ignored.
+                jobs = derive ();
+                if (jobs.size () > 0) pending = std::async (std::launch::async, download, jobs);
+
+                // stage 3: import the txs in order, one sequence at a time.
+                for (size_t j = 0; j < current.size (); j++) {
+                    restore_scan &scan = scans[current[j].Scan];
+                    if (scan.Done) continue;
+
+                    const derived_address &a = current[j].Address;
+                    const restore_download &d = downloaded[j];
+
+                    std::cout << "  recovering address " << a.Index << " of " << scan.Name << ": " << a.Address << std::endl;
+
+                    if (m == mode::backfill) {
+                        if (a.Index + 1 >= scan.Last) scan.Done = true;
+                    } else if (data::size (d.History) == 0) {
+                        // addresses that we already know have been used don't count toward the gap.
+                        if (a.Index >= scan.Last) {
+                            if (scan.Unused == MaxLookAhead) scan.Done = true;
+                            else scan.Unused++;
+                        }
+                    } else if (a.Index >= scan.Last) {
+                        scan.Unused = 0;
+                        scan.Last = a.Index + 1;
+                    }
+
+                    if (data::size (d.History) != 0) {
+
+                        signing x {{derivation {scan.Sequence.Parent, scan.Sequence.Path << a.Index}},
+                            pay_to_address::redeem_expected_size ()};
+
+                        std::lock_guard<std::mutex> lock (local_mutex);
+                        for (const cached_remote_TXDB::downloaded &tx : d.Transactions) txdb.import_transaction (tx);
+
+                        if (m == mode::unspent) {
+                            std::cout << "  found " << d.Unspent.size () << " unspent outputs for address " << a.Address << std::endl;
+                            for (const whatsonchain::UTXO &u : d.Unspent) {
+                                Bitcoin::output o = txdb.Local.output (u.Outpoint);
+                                if (o.Value != u.Value) throw exception {} << "could not find unspent output " << write (u.Outpoint);
+                                scan.Received.insert_or_assign (u.Outpoint, redeemable {o, x});
+                            }
+                        } else {
+                            events ev;
+                            for (const event &e : txdb.Local.by_address (a.Address)) {
+                                // in a rescan we only want events from new txs.
+                                if (m == mode::rescan && !data::contains (d.History, e.id ())) continue;
+                                ev <<= e;
+                                if (e.Direction == direction::out)
+                                    scan.Received.insert_or_assign (e.point (), redeemable {e->Transaction.Outputs[e.Index], x});
+                                else scan.Spent.insert_or_assign (e->Transaction.Inputs[e.Index].Reference, inpoint {e.id (), e.Index});
+                            }
+
+                            std::cout << "  found " << ev.size () << " events for address " << a.Address << std::endl;
+                            scan.History = scan.History + ev;
+                        }
+                    }
+
+                    restore_progress::sequence &progress = r.Progress.Sequences[scan.Name];
+                    if (m == mode::backfill) {
+                        progress.Backfilled = a.Index + 1;
+                        progress.HistoryComplete = scan.Done;
+                    } else {
+                        progress.First = scan.First;
+                        progress.Checked = a.Index + 1;
+                        progress.Last = scan.Last;
+                        progress.Height = scan.Height;
+                        progress.Done = scan.Done;
+
+                        // a rescan leaves the backfill alone.
+                        if (m == mode::history) {
+                            progress.Backfilled = a.Index + 1;
+                            progress.HistoryComplete = scan.Done;
+                        } else if (m == mode::unspent) {
+                            progress.Backfilled = scan.First;
+                            progress.HistoryComplete = false;
+                        }
+                    }
                 }
-                std::cout << " " << e.value ();
-                when w = e->when ();
-                if (w == when::unconfirmed ()) std::cout << " recently";
-                else std::cout << " on " << w;
-                std::cout << std::endl;
+            }
+        } catch (const std::exception &x) {
+            r.Error = std::string {x.what ()};
+        }
 
+        // outputs that were both received and spent are not in the account.
+        std::map<Bitcoin::outpoint, inpoint> spent;
+        std::map<Bitcoin::outpoint, bool> received;
+        for (const restore_scan &scan : scans) {
+            for (const auto &[op, in] : scan.Spent) spent.insert_or_assign (op, in);
+            for (const auto &[op, _] : scan.Received) received[op] = true;
+        }
+
+        for (const restore_scan &scan : scans) {
+            std::cout << "done checking address sequence " << scan.Name << std::endl;
+
+            std::map<Bitcoin::TXID, account_diff> inserted;
+            for (const auto &[op, re] : scan.Received) if (!spent.contains (op)) {
+                account_diff &d = inserted[op.Digest];
+                d.TXID = op.Digest;
+                d.Insert = d.Insert.insert (op.Index, re);
             }
 
-            total_received += received;
-            total_spent += spent;
-            total_in_wallet += in_wallet;
+            // outputs that were already in the account before and have now been spent.
+            std::map<Bitcoin::TXID, account_diff> removed;
+            for (const auto &[op, in] : scan.Spent) if (!received.contains (op)) {
+                account_diff &d = removed[in.Digest];
+                d.TXID = in.Digest;
+                d.Remove = d.Remove.insert (in.Index, op);
+            }
 
-            std::cout << "    total received  " << total_received << std::endl;
-            std::cout << "    total spent     " << total_spent << std::endl;
-            std::cout << "    total in wallet " << total_in_wallet << std::endl;
+            list<account_diff> diffs;
+            for (const auto &[_, d] : inserted) diffs <<= d;
+            for (const auto &[_, d] : removed) diffs <<= d;
 
+            r.Restored = r.Restored.insert (scan.Name, restored {scan.History, diffs, scan.Last});
         }
 
-        list<account_diff> diffs;
-        for (const auto &[txid, ins] : a) diffs <<= account_diff {txid, ins, {}};
-
-        return restored {v, diffs, last.Last};
+        return r;
     }
 
 }
-
-
@@ -0,0 +1,124 @@
+#include <Cosmos/wallet/sighash.hpp>
+
+namespace Cosmos {
+
+    namespace {
+        constexpr byte sighash_none {0x02};
+        constexpr byte sighash_single {0x03};
+        constexpr byte sighash_fork_id {0x40};
+        constexpr byte sighash_anyone_can_pay {0x80};
+
+        struct preimage_writer {
+            std::vector<byte> Bytes;
+
+            preimage_writer &write (const byte *b, size_t size) {
+                Bytes.insert (Bytes.end (), b, b + size);
+                return *this;
+            }
+
+            preimage_writer &operator << (const bytes &b) {
+                return write (b.data (), b.size ());
+            }
+
+            preimage_writer &operator << (const digest256 &d) {
+                return write (d.data (), d.size ());
+            }
+
+            // all integers are written little endian.
+            preimage_writer &write_uint (uint64 x, size_t size) {
+                for (size_t i = 0; i < size; i++) Bytes.push_back (static_cast<byte> (x >> (8 * i)));
+                return *this;
+            }
+
+            preimage_writer &write_var_int (uint64 x) {
+                if (x < 0xfd) return write_uint (x, 1);
+                if (x <= 0xffff) return write_uint (0xfd, 1).write_uint (x, 2);
+                if (x <= 0xffffffff) return write_uint (0xfe, 1).write_uint (x, 4);
+                return write_uint (0xff, 1).write_uint (x, 8);
+            }
+
+            preimage_writer &operator << (const Bitcoin::outpoint &o) {
+                return (*this << o.Digest).write_uint (uint32 (o.Index), 4);
+            }
+
+            preimage_writer &operator << (const Bitcoin::output &o) {
+                write_uint (static_cast<uint64> (int64 (o.Value)), 8).write_var_int (o.Script.size ());
+                return *this << o.Script;
+            }
+
+            bytes finish () const {
+                bytes b (Bytes.size ());
+                std::copy (Bytes.begin (), Bytes.end (), b.begin ());
+                return b;
+            }
+
+            digest256 hash () const {
+                return Gigamonkey::Hash256 (finish ());
+            }
+        };
+    }
+
+    sighash_context::sighash_context (const Bitcoin::incomplete::transaction &tx) :
+        Version {tx.Version}, LockTime {tx.LockTime}, Outpoints {}, Sequences {}, Outputs {} {
+        preimage_writer prevouts {};
+        preimage_writer sequences {};
+        preimage_writer outputs {};
+
+        for (const auto &in : tx.Inputs) {
+            Outpoints.push_back (in.Reference);
+            Sequences.push_back (in.Sequence);
+            prevouts << in.Reference;
+            sequences.write_uint (uint32 (in.Sequence), 4);
+        }
+
+        for (const auto &out : tx.Outputs) {
+            Outputs.push_back (out);
+            outputs << out;
+        }
+
+        HashPrevouts = prevouts.hash ();
+        HashSequence = sequences.hash ();
+        HashOutputs = outputs.hash ();
+    }
+
+    bytes sighash_context::preimage (Bitcoin::index input, Bitcoin::satoshi value,
+        const bytes &script_code, Bitcoin::sighash::directive d) const {
+        if (input >= Outpoints.size ()) throw exception {} << "input index " << input << " out of range";
+
+        byte directive = static_cast<byte> (d);
+        if (!(directive & sighash_fork_id)) throw exception {} << "only forkid signatures are supported";
+
+        byte base = directive & 0x1f;
+        bool anyone_can_pay = directive & sighash_anyone_can_pay;
+
+        digest256 zero {};
+
+        digest256 hash_outputs = zero;
+        if (base != sighash_single && base != sighash_none) hash_outputs = HashOutputs;
+        else if (base == sighash_single && input < Outputs.size ()) {
+            preimage_writer single {};
+            single << Outputs[input];
+            hash_outputs = single.hash ();
+        }
+
+        preimage_writer w {};
+        w.write_uint (static_cast<uint32> (int32 (Version)), 4);
+        w << (anyone_can_pay ? zero : HashPrevouts);
+        w << (anyone_can_pay || base == sighash_single || base == sighash_none ? zero : HashSequence);
+        w << Outpoints[input];
+        w.write_var_int (script_code.size ()) << script_code;
+        w.write_uint (static_cast<uint64> (int64 (value)), 8);
+        w.write_uint (uint32 (Sequences[input]), 4);
+        w << hash_outputs;
+        w.write_uint (uint32 (LockTime), 4);
+        w.write_uint (directive, 4);
+
+        return w.finish ();
+    }
+
+    Bitcoin::signature sighash_context::sign (const Bitcoin::secret &k, Bitcoin::index input, Bitcoin::satoshi value,
+        const bytes &script_code, Bitcoin::sighash::directive d) const {
+        return Bitcoin::signature {k.Secret.sign (digest (input, value, script_code, d)), d};
+    }
+
+}
@@ -0,0 +1,82 @@
+#include <Cosmos/wallet/sign.hpp>
+#include <gigamonkey/script/pattern/pay_to_pubkey.hpp>
+#include <type_traits>
+
+namespace Cosmos {
+
+    namespace {
+        // whether r is the function f. A redeem function cannot be compared
+        // directly so we look at what is stored inside it.
+        template <typename F> bool redeems_with (const redeem &r, const F &f) {
+            using target = std::decay_t<F>;
+            const target *x = r.template target<target> ();
+            if constexpr (std::is_pointer_v<target>) return x != nullptr && *x == &f;
+            else return x != nullptr;
+        }
+    }
+
+    maybe<bytes> signer::sign (const sighash_context &context, Bitcoin::index index) const {
+        if (data::size (Keys) != 1 || UnlockScriptSoFar.size () != 0) return {};
+
+        const bytes &script = Prevout.Value.Script;
+        const Bitcoin::secret &key = first (Keys);
+        Bitcoin::pubkey pubkey = key.to_public ();
+
+        // OP_DUP OP_HASH160 <20 bytes> OP_EQUALVERIFY OP_CHECKSIG
+        bool is_p2pkh = script.size () == 25 && script[0] == 0x76 && script[1] == 0xa9 &&
+            script[2] == 0x14 && script[23] == 0x88 && script[24] == 0xac;
+
+        // <pubkey> OP_CHECKSIG
+        bool is_p2pk = script.size () == pubkey.size () + 2 && script[0] == pubkey.size () &&
+            script[script.size () - 1] == 0xac;
+
+        if (is_p2pkh) {
+            digest160 address_hash = Gigamonkey::Hash160 (pubkey);
+            if (!std::equal (address_hash.begin (), address_hash.end (), script.begin () + 3)) return {};
+        } else if (is_p2pk) {
+            if (!std::equal (pubkey.begin (), pubkey.end (), script.begin () + 1)) return {};
+        } else return {};
+
+        Bitcoin::signature sig = context.sign (key, index, Prevout.Value.Value, script, DefaultDirective);
+        return is_p2pkh ? pay_to_address::redeem (sig, pubkey) : Gigamonkey::pay_to_pubkey::redeem (sig);
+    }
+
+    Gigamonkey::redeemable_transaction signable_transaction::design () const {
+        list<Gigamonkey::redeemer> inputs;
+        for (const signer &in : Inputs) inputs <<= Gigamonkey::redeemer (in);
+        return Gigamonkey::redeemable_transaction {Version, inputs, Outputs, LockTime};
+    }
+
+    Bitcoin::incomplete::transaction signable_transaction::incomplete () const {
+        list<Bitcoin::incomplete::input> inputs;
+        for (const signer &in : Inputs) inputs <<= Bitcoin::incomplete::input {in.Prevout.Key, in.Sequence};
+        return Bitcoin::incomplete::transaction {Version, inputs, Outputs, LockTime};
+    }
+
+    extended_transaction signable_transaction::sign (redeem r, uint32 threads) const {
+        Bitcoin::incomplete::transaction tx = incomplete ();
+
+        // the parts of the sighash preimage that every input shares are computed once.
+        sighash_context context {tx};
+
+        // the fast path writes the same scripts that redeem_p2pkh_and_p2pk
+        // would, so we don't use it if we were given something else.
+        bool fast = redeems_with (r, Gigamonkey::redeem_p2pkh_and_p2pk);
+
+        std::vector<bytes> scripts = parallel_map<bytes> (Inputs.size (), [this, &tx, &context, &r, fast] (size_t i) -> bytes {
+            const signer &in = Inputs[i];
+            if (fast)
+                if (maybe<bytes> script = in.sign (context, static_cast<Bitcoin::index> (i)); bool (script)) return *script;
+            return r (Bitcoin::sighash::document {tx, static_cast<Bitcoin::index> (i),
+                in.Prevout.Value.Value, in.Prevout.Value.Script}, in.sigops (), in.UnlockScriptSoFar);
+        }, threads);
+
+        list<Gigamonkey::extended::input> inputs;
+        for (size_t i = 0; i < Inputs.size (); i++)
+            inputs <<= Gigamonkey::extended::input {Inputs[i].Prevout.Value,
+                Bitcoin::input {Inputs[i].Prevout.Key, scripts[i], Inputs[i].Sequence}};
+
+        return extended_transaction {Version, inputs, Outputs, LockTime};
+    }
+
+}
@@ -2,8 +2,6 @@
 
 namespace Cosmos {
 
-    const uint32 output_size = 34;
-
     // here e_x means exponential of x. Thus the variables are not all independent.
     double log_triangular_distribution_mean (double a, double b, double m, double e_a, double e_b, double e_m);
 
@@ -40,18 +38,23 @@ namespace Cosmos {
         return (e_b * (a - b + 1) - e_a) * 2 / ((a - b) * (b - a));
     }
 
+    // The mean is increasing in the mode but there is no closed form for
+    // its inverse, so we bisect. The interval halves at every step, so
+    // the number of steps is bounded by the precision of a double.
     double find_triangle_mode (double a, double b, double mean, double e_a, double e_b) {
         double min = a;
         double max = b;
-        double guess, m;
+        double m = (max - min) / 2 + min;
 
-        while (true) {
-            // it's possible to converge a lot faster than this but let's see if this works well enough.
-            double m = (max - min) / 2 + min;
+        for (int i = 0; i < 128 && min < max; i++) {
+            m = (max - min) / 2 + min;
             double guess = log_triangular_distribution_mean (a, b, m, e_a, e_b);
-            if (std::max (mean - guess, guess - mean) > 1) return m;
+            // close enough if we are within a satoshi.
+            if (std::abs (mean - guess) <= 1) return m;
             (guess > mean ? max : min) = m;
         }
+
+        return m;
     }
 
     split::log_triangular_distribution::log_triangular_distribution (double min, double max, double mean) {
@@ -65,11 +68,18 @@ namespace Cosmos {
         if (mean < min) throw exception {} <<
             "log triangular distribution: mean (" << mean << ") must not be less than min (" << min << ")";
 
-        double a = ln (double (min));
-        double b = ln (double (max));
+        A = ln (double (min));
+        B = ln (double (max));
+
+        if (A == B) {
+            Mode = A;
+            ModeCDF = 1;
+            Left = Right = 0;
+            return;
+        }
 
-        double min_mean = min_log_triangular_distribution_mean (a, b, min, max);
-        double max_mean = max_log_triangular_distribution_mean (a, b, min, max);
+        double min_mean = min_log_triangular_distribution_mean (A, B, min, max);
+        double max_mean = max_log_triangular_distribution_mean (A, B, min, max);
 
         if (mean < min_mean) throw exception {} <<
             "Minimum possible mean value for max " << max << " and min " << min << " is " << min_mean;
@@ -77,23 +87,43 @@ namespace Cosmos {
         if (mean > max_mean) throw exception {} <<
             "Maximum possible mean value for max " << max << " and min " << min << " is " << max_mean;
 
-        Triangular = math::triangular_distribution<double> {a, find_triangle_mode (a, b, mean, min, max), b};
+        Mode = find_triangle_mode (A, B, mean, min, max);
+        ModeCDF = (Mode - A) / (B - A);
+        Left = (B - A) * (Mode - A);
+        Right = (B - A) * (B - Mode);
+    }
+
+    const split::log_triangular_distribution &split::log_triangular_distribution::get (double min, double max, double mean) {
+        static std::mutex mutex;
+        static std::map<std::tuple<double, double, double>, log_triangular_distribution> cache;
 
+        std::lock_guard<std::mutex> lock (mutex);
+        auto key = std::make_tuple (min, max, mean);
+        auto x = cache.find (key);
+        if (x == cache.end ()) x = cache.emplace (key, log_triangular_distribution {min, max, mean}).first;
+        return x->second;
     }
 
-    split::result_outputs split::operator () (data::crypto::random &r, address_sequence key,
-        Bitcoin::satoshi split_value, double fee_rate) const {
+    maybe<std::vector<Bitcoin::satoshi>> split::values (data::crypto::random &r,
+        Bitcoin::satoshi split_value, double fee_rate, uint32 max_outputs) const {
 
-        list<redeemable> outputs {};
+        std::vector<Bitcoin::satoshi> values {};
+
+        // random values are generated in batches of about as many as we expect to need.
+        std::vector<double> random_values {};
+        size_t next_random_value {0};
+        size_t batch_size = std::clamp<size_t> (size_t (double (int64 (split_value)) / MeanSatsPerOutput) + 1, 1, 1024);
 
         int64 remaining_split_value = split_value;
 
         while (true) {
+            if (values.size () == max_outputs) return {};
+
             // how many outputs will we have by the next iteration?
-            uint32 outputs_size_next = outputs.size () + 1;
+            uint32 outputs_size_next = values.size () + 1;
 
             // how many fees will we have accumulated by the next iteration?
-            int64 expected_fees_next = ceil (fee_rate * (Bitcoin::var_int::size (outputs_size_next) + (outputs_size_next) * output_size));
+            int64 expected_fees_next = ceil (fee_rate * (Bitcoin::var_int::size (outputs_size_next) + (outputs_size_next) * size_estimator::P2PKHOutputSize));
 
             // remaining number of satoshies, after the cost of all the expected outputs is taken into account,
             int64 expected_remainder = remaining_split_value - expected_fees_next;
@@ -101,28 +131,47 @@ namespace Cosmos {
             // this will only happen if not enough sats are provided initially.
             if (expected_remainder < MinSatsPerOutput) throw exception {} << "too few sats to split!";
 
+            if (next_random_value == random_values.size ()) {
+                random_values.clear ();
+                next_random_value = 0;
+                LogTriangular.generate (r, random_values, batch_size);
+            }
+
             // round up.
-            int64 random_value = int64 (LogTriangular (r) + .5);
+            int64 random_value = int64 (random_values[next_random_value++] + .5);
 
             // if the remaining sats will be too few, just make a final output using all that's left.
             bool we_are_done = expected_remainder - random_value < MinSatsPerOutput;
 
             int64 output_value = we_are_done ? expected_remainder : random_value;
 
+            values.push_back (Bitcoin::satoshi {output_value});
+
+            if (we_are_done) return values;
+
+            remaining_split_value -= output_value;
+        }
+    }
+
+    split::result_outputs split::operator () (data::crypto::random &r, address_sequence key,
+        Bitcoin::satoshi split_value, double fee_rate) const {
+
+        list<redeemable> outputs {};
+
+        for (const Bitcoin::satoshi &output_value : *values (r, split_value, fee_rate)) {
             entry<Bitcoin::address, signing> last_address = pay_to_address_signing (key.last ());
 
-            outputs = outputs << redeemable {
-                Bitcoin::output {Bitcoin::satoshi {output_value}, pay_to_address::script (last_address.Key.digest ())},
+            outputs <<= redeemable {
+                Bitcoin::output {output_value, pay_to_address::script (last_address.Key.digest ())},
                 last_address.Value.Derivation,
                 last_address.Value.ExpectedScriptSize,
                 last_address.Value.UnlockScriptSoFar};
 
-            if (we_are_done) return result_outputs {outputs, key.Last};
-
-            remaining_split_value -= output_value;
-
             key = key.next ();
         }
+
+        // the index of the next unused key.
+        return result_outputs {outputs, key.Last};
     }
 
     split::result split::operator () (redeem ree, data::crypto::random &rand,
@@ -130,24 +179,13 @@ namespace Cosmos {
         list<entry<Bitcoin::outpoint, redeemable>> selected, double fee_rate) const {
         using namespace Gigamonkey;
         std::cout << "splitting tx with mean size " << MeanSatsPerOutput << std::endl;
-        uint32 expected_tx_size_other_than_outputs;
-        {
-            uint32 num_inputs = data::size (selected);
-            uint32 redeem_script_size = Bitcoin::signature::MaxSize + 33 + 2;
-            expected_tx_size_other_than_outputs =
-                4 +                                            // version
-                4 +                                            // locktime
-                Bitcoin::var_int::size (num_inputs) +          // num inputs
-                num_inputs * (40 + redeem_script_size +        // input size
-                    Bitcoin::var_int::size (redeem_script_size));
-        }
+        size_estimator estimate {};
+        for (const auto &[_, re] : selected) estimate.add_input (re);
 
-        Bitcoin::satoshi split_value;
-
-        {
-            for (const auto &[key, value] : selected) split_value += value.Prevout.Value;
-            split_value -= ceil (expected_tx_size_other_than_outputs * fee_rate);
-        }
+        // the fee for everything but the outputs. The number of outputs
+        // is included with the fees of the outputs in split::values.
+        Bitcoin::satoshi split_value = estimate.Spent -
+            Bitcoin::satoshi {int64 (std::ceil (fee_rate * estimate.size_without_outputs ()))};
 
         if (split_value < MinSatsPerOutput) throw exception {5} << "too few sats to split!";
 
@@ -155,21 +193,26 @@ namespace Cosmos {
         result_outputs split_outputs = operator () (rand, x, split_value, fee_rate);
         split_outputs.Outputs = shuffle (shuffle (split_outputs.Outputs, rand));
 
-        extended_transaction completed = redeemable_transaction {1,
-            for_each ([k, p] (const entry<Bitcoin::outpoint, redeemable> &e) -> redeemer {
-
-                auto d = first (e.Value.Derivation);
-                Bitcoin::secret sec = find_secret (k, p, d);
-                if (!sec.valid ()) throw exception {} << "could not find secret key for " << d;
-
-                return redeemer {
-                    list<sigop> {sigop {sec}},
-                    Bitcoin::prevout {e.Key, e.Value.Prevout},
-                    e.Value.ExpectedScriptSize};
+        // all inputs are likely to have the same parent key, so
+        // we only derive it once.
+        derivation_cache keys {};
+
+        std::vector<signer> inputs;
+        inputs.reserve (data::size (selected));
+        for (const entry<Bitcoin::outpoint, redeemable> &e : selected) {
+            auto d = first (e.Value.Derivation);
+            Bitcoin::secret sec = find_secret (k, p, d, keys);
+            if (!sec.valid ()) throw exception {} << "could not find secret key for " << d;
+
+            inputs.push_back (signer {
+                list<Bitcoin::secret> {sec},
+                Bitcoin::prevout {e.Key, e.Value.Prevout},
+                e.Value.ExpectedScriptSize});
+        }
 
-            }, selected), for_each ([] (const auto &x) -> Bitcoin::output {
+        extended_transaction completed = signable_transaction {1, inputs, for_each ([] (const auto &x) -> Bitcoin::output {
                 return x.Prevout;
-            }, split_outputs.Outputs), 0}.redeem (ree);
+            }, split_outputs.Outputs), 0}.sign (ree);
 
         if (!completed.valid ()) throw exception {6} << "invalid tx generated";
 
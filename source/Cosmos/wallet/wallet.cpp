@@ -13,6 +13,24 @@ namespace Cosmos {
         return Bitcoin::secret {};
     }
 
+    Bitcoin::secret find_secret (const keychain &k, const pubkeys &p, derivation d, derivation_cache &c) {
+        if (const auto *v = p.contains (d.Parent); bool (v))
+            d = derivation {v->Parent, v->Path + d.Path};
+        if (k.contains (d.Parent)) return c.derive (k, d);
+        return Bitcoin::secret {};
+    }
+
+    // put element i of x at index ordering[i].
+    list<Bitcoin::output> place (list<Bitcoin::output> x, const cross<size_t> &ordering) {
+        std::vector<Bitcoin::output> placed (ordering.size ());
+        size_t i = 0;
+        for (const Bitcoin::output &o : x) placed[ordering[i++]] = o;
+
+        list<Bitcoin::output> result;
+        for (const Bitcoin::output &o : placed) result <<= o;
+        return result;
+    }
+
     spend::spent spend::operator () (redeem r,
         keychain k, wallet w,
         list<Bitcoin::output> to,
@@ -33,35 +51,37 @@ namespace Cosmos {
         // do we have enough funds to spend everything we want to spend?
         if (value_available < value_to_spend) throw exception {3} << "insufficient funds: " << value_available << " < " << value_to_spend;
 
-        list<redeemer> inputs;
+        std::vector<signer> inputs;
         account_diff diff;
 
         // select funds to be spent and organize them into redeemers and keep
         // track of outputs that will be removed from the wallet.
+        // inputs usually share account keys so we only derive those once.
+        derivation_cache keys {};
+
+        size_estimator estimate {};
+
         Bitcoin::index input_index = 0;
         for (const auto &[op, re] : Select (w.Account, value_to_spend, fees, Random)) {
-            inputs <<= redeemer {
-                for_each ([&k, w] (const derivation &x) -> sigop {
-                    Bitcoin::secret sec = find_secret (k, w.Pubkeys, x);
+            estimate.add_input (re);
+            inputs.push_back (signer {
+                for_each ([&k, &w, &keys] (const derivation &x) -> Bitcoin::secret {
+                    Bitcoin::secret sec = find_secret (k, w.Pubkeys, x, keys);
                     if (!sec.valid ()) throw exception {} << "could not find secret key for " << x;
-                    return sigop {sec};
+                    return sec;
                 }, re.Derivation),
                 Bitcoin::prevout {op, re.Prevout},
                 re.ExpectedScriptSize,
                 Bitcoin::input::Finalized,
-                re.UnlockScriptSoFar};
+                re.UnlockScriptSoFar});
             diff.Remove = diff.Remove.insert (input_index++, op);
         }
 
-        // transform selected into inputs
-        redeemable_transaction design_before_change {1, inputs, to, lock};
-
-        // how much do we need to make in change?
-        satoshis_per_byte fee_rate_before_change {design_before_change.fee (), design_before_change.expected_size ()};
+        for (const Bitcoin::output &o : to) estimate.add_output (o);
 
         // what change needs to be accounted for in order to make this tx?
         Bitcoin::satoshi change_amount
-            {floor (double (int64 (fee_rate_before_change.Satoshis)) - double (fees) * fee_rate_before_change.Bytes)};
+            {floor (double (int64 (estimate.fee ())) - double (fees) * estimate.size ())};
 
         // make change outputs.
 
@@ -72,27 +92,87 @@ namespace Cosmos {
         // randomly order the new outputs.
         cross<size_t> outputs_ordering = random_ordering (to.size () + change_outputs.size (), Random);
 
-        // shuffle outputs and construct tx.
-        redeemable_transaction design {1, inputs, shuffle (change_outputs + to, outputs_ordering), lock};
+        for (const Bitcoin::output &o : change_outputs) estimate.add_output (o);
 
         // Is the fee for this transaction sufficient?
-        if (design.fee_rate () < fees) throw exception {3} << "failed to generate tx with sufficient fees";
-        std::cout << " transaction design is complete. It has " << design.Inputs.size () << " inputs spending " << design.spent () << ", " <<
-            design.Outputs.size () << " outputs sending " << design.sent () << " with fees " << design.fee  () << std::endl;
-        // redeem transaction.
-        extended_transaction complete = design.redeem (r);
+        if (estimate.fee_rate () < fees) throw exception {3} << "failed to generate tx with sufficient fees";
+        std::cout << " transaction design is complete. It has " << estimate.Inputs << " inputs spending " << estimate.Spent << ", " <<
+            estimate.Outputs << " outputs sending " << estimate.Sent << " with fees " << estimate.fee () << std::endl;
+
+        // shuffle outputs and construct tx.
+        signable_transaction signable {1, inputs, place (change_outputs + to, outputs_ordering), lock};
+        // redeem transaction. Inputs are signed in parallel.
+        extended_transaction complete = signable.sign (r);
 
         if (!complete.valid ()) throw exception {3} << "invalid tx generated";
 
         // add new change outputs to account.
         diff.TXID = complete.id ();
-        for (int i = 0; i < change_outputs.size (); i++) {
-            size_t change_index = outputs_ordering[i];
-            diff.Insert = diff.Insert.insert (outputs_ordering[i++], ch.Change[change_index]);
-        }
+        for (int i = 0; i < change_outputs.size (); i++)
+            diff.Insert = diff.Insert.insert (outputs_ordering[i], ch.Change[i]);
 
         // return new wallet.
         return spent {{{complete, diff}}, w.Addresses.update (w.Addresses.Change, ch.Last)};
     }
+
+    spend::spent_unsigned spend::operator () (nosig::write_scripts write,
+        wallet w,
+        list<Bitcoin::output> to,
+        satoshis_per_byte fees,
+        uint32 lock) const {
+
+        Bitcoin::satoshi value_to_spend = data::fold
+            ([] (Bitcoin::satoshi val, const Bitcoin::output &o) -> Bitcoin::satoshi {
+                return val + o.Value;
+            }, Bitcoin::satoshi {0}, to);
+
+        Bitcoin::satoshi value_available = w.Account.value ();
+
+        if (value_available < value_to_spend) throw exception {3} << "insufficient funds: " << value_available << " < " << value_to_spend;
+
+        list<nosig::input> inputs;
+        account_diff diff;
+
+        // we can't know the size of the signatures yet, so we use the expected sizes.
+        size_estimator estimate {};
+
+        Bitcoin::index input_index = 0;
+        for (const auto &[op, re] : Select (w.Account, value_to_spend, fees, Random)) {
+            inputs <<= nosig::input {Bitcoin::prevout {op, re.Prevout}, write (re)};
+            estimate.add_input (re);
+            diff.Remove = diff.Remove.insert (input_index++, op);
+        }
+
+        for (const Bitcoin::output &o : to) estimate.add_output (o);
+
+        Bitcoin::satoshi change_amount
+            {floor (double (int64 (estimate.fee ())) - double (fees) * estimate.size ())};
+
+        change ch = Change (w.Addresses.Sequences[w.Addresses.Change], change_amount, fees, Random);
+
+        auto change_outputs = ch.outputs ();
+
+        cross<size_t> outputs_ordering = random_ordering (to.size () + change_outputs.size (), Random);
+
+        nosig::transaction tx {1, inputs, place (change_outputs + to, outputs_ordering), lock};
+
+        for (int i = 0; i < change_outputs.size (); i++)
+            diff.Insert = diff.Insert.insert (outputs_ordering[i], ch.Change[i]);
+
+        return spent_unsigned {{{tx, diff}}, w.Pubkeys, w.Addresses.update (w.Addresses.Change, ch.Last)};
+    }
+
+    spend::spent spend::spent_unsigned::sign (const keychain &k) const {
+        // all transactions share one cache since they are likely to use the same keys.
+        derivation_cache keys {};
+        list<std::pair<extended_transaction, account_diff>> signed_txs;
+        for (const auto &[tx, diff] : Transactions) {
+            extended_transaction complete = tx.sign (k, Pubkeys, keys);
+            if (!complete.valid ()) throw exception {3} << "invalid tx generated";
+            signed_txs <<= {complete, account_diff {complete.id (), diff.Insert, diff.Remove}};
+        }
+
+        return spent {signed_txs, Addresses};
+    }
 }
 
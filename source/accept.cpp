@@ -17,96 +17,155 @@ namespace Cosmos {
         using imap = map<Bitcoin::index, redeemable>;
 
         // all outputs that will be ours if we accept this payment.
-        // TODO we can make things easier later on by making this a
         map<Bitcoin::TXID, imap> Out;
 
         list<tuple<string, payments::request, Bitcoin::satoshi>> RequestsSatisfied;
 
-        Bitcoin::satoshi search_script (const bytes &script, const signing &sg) {
-            int outputs_found {0};
-            Bitcoin::satoshi total_value {0};
-
-            // does the transaction pay to this address?
-            for (const auto &[txid, extx] : Payment) {
-                Out = Out.insert (txid, imap {});
-                Bitcoin::index i {0};
-                for (const auto &op : extx.Outputs) {
-                    if (op.Script == script) {
-                        total_value += op.Value;
-                        entry<Bitcoin::index, redeemable> e {i++, redeemable {op, sg}};
-                        Out = Out.replace_part (txid, [e] (const imap &m) -> imap {
-                            return m.insert (e);
-                        });
-                        outputs_found++;
-                    }
-                    i++;
-                }
+        // value paid to addresses in our own sequences that were not requested.
+        Bitcoin::satoshi Unrequested;
 
-            }
+        // the last address used (+1) in each of our sequences.
+        std::map<string, uint32> WalletLast;
 
-            if (outputs_found > 1) std::cout << "WARNING: more than one output found with the same script";
-            return total_value;
-        }
+        // a script that would satisfy a payment request.
+        struct watched {
+            string ID;
+            signing Signing;
+        };
 
-        request_integrator (list<Bitcoin::transaction> txs, const map<string, payments::redeemable> &pmts) {
+        // xpub requests can be paid to any address derived from the xpub,
+        // so we keep a pool of addresses for each of them. Outputs to any
+        // address in the pool of the wallet's own sequences are also ours.
+        request_integrator (list<Bitcoin::transaction> txs, const map<string, payments::redeemable> &pmts,
+            address_pool &xpubs, const address_pool &wallet) {
             for (const auto &tx : txs) Payment = Payment.insert (tx.id (), tx);
 
-            // check payments to see if we can figure out which payment request this satisfies.
-            for (const auto &[id, re] : pmts)
-                // we have three types of payment requests. Address, pubkey, and xpub.
-                if (Bitcoin::address addr {id}; addr.valid ()) {
+            // every script that would satisfy one of our requests, indexed by its hash.
+            std::unordered_map<digest256, watched, digest_hash> scripts;
 
-                    Bitcoin::satoshi value_paid = search_script (
-                        pay_to_address {addr.digest ()}.script (),
+            // we have three types of payment requests. Address, pubkey, and xpub.
+            for (const auto &[id, re] : pmts)
+                if (Bitcoin::address addr {id}; addr.valid ())
+                    scripts[Gigamonkey::SHA2_256 (pay_to_address {addr.digest ()}.script ())] =
                         // assuming here that the pubkey is compressed, since we don't know.
-                        signing {{re.Derivation}, pay_to_address::redeem_expected_size ()});
+                        watched {id, signing {{re.Derivation}, pay_to_address::redeem_expected_size ()}};
+                else if (Bitcoin::pubkey pk {id}; pk.valid ())
+                    scripts[Gigamonkey::SHA2_256 (pay_to_pubkey {pk}.script ())] =
+                        watched {id, signing {{re.Derivation}, pay_to_pubkey::redeem_expected_size ()}};
+                else if (HD::BIP_32::pubkey xpub {id}; xpub.valid ()) {
+                    // the xpub itself may be used as an address.
+                    scripts[Gigamonkey::SHA2_256 (pay_to_address {xpub.address ().Digest}.script ())] =
+                        watched {id, signing {{re.Derivation}, pay_to_address::redeem_expected_size ()}};
+                    // nothing is derived if the pool already has this xpub.
+                    xpubs.extend (id, address_sequence {xpub, {}});
+                } else throw exception {} << "unrecognized payment request type";
 
-                    if (value_paid > 0) RequestsSatisfied <<= {id, re.Request.Value, value_paid};
+            std::map<string, Bitcoin::satoshi> paid;
+
+            // how many outputs pay to each script.
+            std::unordered_map<digest256, uint32, digest_hash> outputs_per_script;
+
+            // if an xpub is paid near the end of its pool, we must look further.
+            bool search_again;
+            do {
+                search_again = false;
+                Out = {};
+                paid.clear ();
+                outputs_per_script.clear ();
+                Unrequested = 0;
+                WalletLast.clear ();
+
+                std::map<string, uint32> last_used;
+                for (const auto &[txid, tx] : Payment) {
+                    imap found {};
+                    Bitcoin::index i {0};
+                    for (const auto &op : tx.Outputs) {
+                        digest256 script_hash = Gigamonkey::SHA2_256 (op.Script);
+                        if (auto w = scripts.find (script_hash); w != scripts.end ()) {
+                            found = found.insert (i, redeemable {op, w->second.Signing});
+                            paid[w->second.ID] += op.Value;
+                            outputs_per_script[script_hash]++;
+                        // the pool may also contain xpubs from requests that have already been paid.
+                        } else if (const auto *x = xpubs.find (script_hash); x != nullptr && bool (pmts.contains (x->Sequence))) {
+                            const derivation &d = pmts[x->Sequence].Derivation;
+                            found = found.insert (i, redeemable {op, signing {{derivation {d.Parent, d.Path << x->Index}},
+                                x->PayToPubkey ? pay_to_pubkey::redeem_expected_size () : pay_to_address::redeem_expected_size ()}});
+                            paid[x->Sequence] += op.Value;
+                            if (x->Index + 1 > last_used[x->Sequence]) last_used[x->Sequence] = x->Index + 1;
+                            outputs_per_script[script_hash]++;
+                        } else if (const auto *x = wallet.find (script_hash); x != nullptr) {
+                            found = found.insert (i, redeemable {op, wallet.signing_at (*x)});
+                            Unrequested += op.Value;
+                            if (x->Index + 1 > WalletLast[x->Sequence]) WalletLast[x->Sequence] = x->Index + 1;
+                            outputs_per_script[script_hash]++;
+                        }
+                        i++;
+                    }
 
-                } else if (Bitcoin::pubkey pk {id}; pk.valid ()) {
+                    Out = Out.insert (txid, found);
+                }
 
-                    Bitcoin::satoshi value_paid = search_script (
-                        pay_to_pubkey {pk}.script (),
-                        // assuming here that the pubkey is compressed, since we don't know.
-                        signing {{re.Derivation}, pay_to_pubkey::redeem_expected_size ()});
-
-                    if (value_paid > 0) RequestsSatisfied <<= {id, re.Request.Value, value_paid};
-
-                } else if (HD::BIP_32::pubkey xpub {id}; xpub.valid ()) {
-
-                    int max_look_ahead = options::DefaultMaxLookAhead;
-                    bool satisfied = false;
-                    Bitcoin::satoshi value_paid {0};
-                    int derivation_value = -1;
-                    int last = -2;
-
-                    do {
-                        // check a bunch of addresses.
-                        Bitcoin::satoshi val = search_script (
-                            pay_to_address {
-                                xpub.derive (derivation_value == -1 ? list<uint32> {} :
-                                    list<uint32> {static_cast<uint32> (derivation_value)}).address ().Digest}.script (),
-                            // assuming here that the pubkey is compressed, since we don't know.
-                            signing {{re.Derivation}, pay_to_address::redeem_expected_size ()});
-
-                        if (val > 0) {
-                            satisfied = true;
-                            value_paid += val;
-                            last = derivation_value;
-                        }
-                    } while (derivation_value - last < max_look_ahead);
+                for (const auto &[id, used] : last_used)
+                    if (used + xpubs.LookAhead > xpubs.end (id)) {
+                        xpubs.extend (id, address_sequence {HD::BIP_32::pubkey {id}, {}}, used);
+                        search_again = true;
+                    }
 
-                    RequestsSatisfied <<= {id, re.Request.Value, value_paid};
+            } while (search_again);
 
-                } else throw exception {} << "unrecognized payment request type";
+            for (const auto &[_, count] : outputs_per_script)
+                if (count > 1) std::cout << "WARNING: more than one output found with the same script" << std::endl;
+
+            for (const auto &[id, re] : pmts)
+                if (auto v = paid.find (id); v != paid.end () && v->second > 0)
+                    RequestsSatisfied <<= {id, re.Request.Value, v->second};
         }
 
         Bitcoin::satoshi total_value () const {
-            Bitcoin::satoshi val {0};
+            Bitcoin::satoshi val {Unrequested};
             for (const auto &[a, b, v] : RequestsSatisfied) val += v;
             return val;
         }
     };
+
+    incoming_payment accept_payment (Interface::writable u, const SPV::proof &payment,
+        function<bool (const incoming_payment &)> approve) {
+        const auto *pay = u.get ().payments ();
+        if (!bool (pay)) throw exception {} << "could not read wallet";
+        auto requests = pay->Requests;
+        address_pool *wallet = u.wallet_pool ();
+        if (!bool (wallet)) throw exception {} << "could not read wallet";
+        request_integrator tg {payment.Payment, requests, *u.xpub_pool (), *wallet};
+
+        incoming_payment x {tg.total_value (), tg.RequestsSatisfied};
+        if (!approve (x)) throw exception {} << "You chose not to accept this payment.";
+
+        // broadcast the transactions.
+        list<std::pair<Bitcoin::transaction, account_diff>> ready;
+        for (const auto &[txid, tx] : tg.Payment) ready <<= {tx, account_diff {txid, tg.Out[txid], {}}};
+
+        if (auto success = u.broadcast (ready); !bool (success))
+            throw exception {} << "Broadcast failed with error " << success;
+
+        // TODO put these in history.
+        auto txids = tg.Out.keys ();
+        for (const auto &[id, a, b] : tg.RequestsSatisfied) {
+            u.history ()->Payments <<= history::payment {id, a, txids};
+            requests = requests.remove (id);
+        }
+
+        u.set_payments (payments {requests, pay->Proposals, pay->Unsigned});
+
+        // addresses past the end of a sequence may have been used.
+        if (tg.WalletLast.size () > 0) {
+            Cosmos::addresses next = *u.get ().addresses ();
+            for (const auto &[name, last] : tg.WalletLast)
+                if (last > next.Sequences[name].Last) next = next.update (name, last);
+            u.set_addresses (next);
+        }
+
+        return x;
+    }
 }
 
 void command_accept (const arg_parser &p) {
@@ -191,42 +250,21 @@ void command_accept (const arg_parser &p) {
     if (payment.Payment.size () == 0) throw exception {} << "no payment found";
     std::cout << payment.Payment.size () << " payment transactions found" << std::endl;
 
-    e.update<void> ([&payment] (Cosmos::Interface::writable u) {
-        const auto *pay = u.get ().payments ();
-        auto requests = pay->Requests;
-        request_integrator tg {payment.Payment, requests};
-
-        Bitcoin::satoshi total_value = tg.total_value ();
-        std::cout << "  " << total_value << " sats found for you. If you accept this payment then your wallet will have " <<
-            (u.get ().account ()->value () + total_value) << " sats." << std::endl;
-
-        std::cout << "  This payment satisfies " << tg.RequestsSatisfied.size () <<
-            " payment request" << (tg.RequestsSatisfied.size () != 1 ? "s" : "") << ":" << std::endl;
-        for (const auto &[str, req, tot] : tg.RequestsSatisfied) {
-            std::cout << "    " << str << " paying " << tot;
-            if (bool (req.Amount)) std::cout << " for " << *req.Amount << " sats requested";
-            std::cout << "." << std::endl;
-        }
-
-        if (!get_user_yes_or_no ("Do you want to accept this payment?"))
-            throw exception {} << "You chose not to accept this payment.";
-
-        // broadcast the transactions.
-        list<std::pair<Bitcoin::transaction, account_diff>> ready;
-        for (const auto &[txid, tx] : tg.Payment) ready <<= {tx, account_diff {txid, tg.Out[txid], {}}};
-
-        if (auto success = u.broadcast (ready); !bool (success))
-            throw exception {} << "Broadcast failed with error " << success;
-
-        // TODO put these in history.
-        auto txids = tg.Out.keys ();
-        for (const auto &[id, a, b] : tg.RequestsSatisfied) {
-            u.history ()->Payments <<= history::payment {id, a, txids};
-            requests = requests.remove (id);
-        }
-
-        u.set_payments (payments {requests, pay->Proposals});
+    e.update<incoming_payment> ([&payment] (Cosmos::Interface::writable u) {
+        return accept_payment (u, payment, [&u] (const incoming_payment &x) -> bool {
+            std::cout << "  " << x.Value << " sats found for you. If you accept this payment then your wallet will have " <<
+                (u.get ().account ()->value () + x.Value) << " sats." << std::endl;
+
+            std::cout << "  This payment satisfies " << x.RequestsSatisfied.size () <<
+                " payment request" << (x.RequestsSatisfied.size () != 1 ? "s" : "") << ":" << std::endl;
+            for (const auto &[str, req, tot] : x.RequestsSatisfied) {
+                std::cout << "    " << str << " paying " << tot;
+                if (bool (req.Amount)) std::cout << " for " << *req.Amount << " sats requested";
+                std::cout << "." << std::endl;
+            }
 
+            return get_user_yes_or_no ("Do you want to accept this payment?");
+        });
     });
 
 }
@@ -0,0 +1,105 @@
+#include <Cosmos/wallet/consolidate.hpp>
+#include "interface.hpp"
+#include "Cosmos.hpp"
+
+void command_consolidate (const arg_parser &p) {
+    using namespace Cosmos;
+    Interface e {};
+    read_wallet_options (e, p);
+    read_random_options (p);
+    options opts = read_tx_options (e, p);
+
+    maybe<double> threshold;
+    p.get (3, "threshold", threshold);
+
+    // consolidation is never urgent, so it only happens when fees are low.
+    maybe<double> max_fee_rate;
+    p.get ("max_fee_rate", max_fee_rate);
+
+    // we compare with what the network is asking for now rather than
+    // with the rate we would pay, which may have been set with --fee_rate.
+    if (bool (max_fee_rate)) {
+        double network_fee_rate = double (e.net ()->mining_fee ());
+        if (network_fee_rate > *max_fee_rate) {
+            std::cout << "current network fee rate " << network_fee_rate << " is above the maximum of " << *max_fee_rate <<
+                " sats per byte; try again later." << std::endl;
+            return;
+        }
+    }
+
+    Cosmos::split split {opts.MinSatsPerOutput, opts.MaxSatsPerOutput, opts.MeanSatsPerOutput};
+    Cosmos::consolidate consolidator {bool (threshold) ?
+        Bitcoin::satoshi {int64 (std::ceil (*threshold))} : opts.MinSatsPerOutput, opts};
+
+    e.update<void> ([&split, &consolidator, &opts] (Cosmos::Interface::writable u) {
+
+        // txs that we have already made may have been accepted since we last checked.
+        update_pending_transactions (u);
+
+        maybe<wallet> w = u.get ().wallet ();
+        if (!bool (w)) throw exception {} << "could not load wallet";
+        wallet original = *w;
+
+        // outputs spent by payments that are still pending must not be consolidated.
+        consolidate::scripts x = consolidator.select (without_proposals (original, u.get ().payments ()).Account);
+        if (data::size (x) == 0) throw exception {1} << "No outputs to consolidate";
+
+        size_t num_outputs {0};
+        Bitcoin::satoshi total_value {0};
+        for (const auto &[_, outputs] : x) {
+            num_outputs += outputs.size ();
+            for (const auto &v : outputs) total_value += v.Value.Prevout.Value;
+        }
+
+        std::cout << "found " << x.size () << " scripts in " << num_outputs <<
+            " outputs to consolidate with a total value of " << total_value << std::endl;
+
+        if (!get_user_yes_or_no ("Do you want to continue?")) throw exception {} << "program aborted";
+
+        consolidate::result consolidated = consolidator (split, Gigamonkey::redeem_p2pkh_and_p2pk, *get_random (),
+            *u.get ().keys (), original.Pubkeys, original.Addresses.change (), x, double (opts.FeeRate));
+
+        list<Bitcoin::transaction> txs;
+
+        size_t total_size {0};
+        Bitcoin::satoshi total_fee {0};
+        size_t total_new_outputs {0};
+
+        account_builder new_account {original.Account};
+
+        for (const auto &[extx, diff] : consolidated.Transactions) {
+            Bitcoin::transaction tx = Bitcoin::transaction (extx);
+            new_account <<= diff;
+            txs <<= tx;
+            size_t size = tx.serialized_size ();
+            total_size += size;
+            total_new_outputs += tx.Outputs.size ();
+            Bitcoin::satoshi fee = extx.fee ();
+            total_fee += fee;
+            std::cout << "  " << extx.id () << "\n  of size " << size << " with " << tx.Inputs.size () <<
+                " inputs, " << tx.Outputs.size () << " outputs and " << fee << " in fees." << std::endl;
+        }
+
+        wallet next {original.Pubkeys,
+            original.Addresses.update (original.Addresses.Change, consolidated.Last), new_account.finalize ()};
+
+        std::cout << "Transactions have been generated!" << std::endl;
+        std::cout << "  number of transactions: " << txs.size () << std::endl;
+        std::cout << "  outputs: " << num_outputs << " -> " << total_new_outputs << std::endl;
+        std::cout << "  total size: " << total_size << std::endl;
+        std::cout << "  total fees: " << total_fee << std::endl;
+
+        // all txs are broadcast together in a single proof.
+        maybe<SPV::proof> proof = SPV::generate_proof (*u.txdb (), txs);
+        if (!bool (proof)) throw exception {} << "could not generate SPV proof for consolidation transactions";
+
+        if (!get_user_yes_or_no ("Do you want broadcast these transactions?")) throw exception {} << "program aborted";
+
+        std::cout << "broadcasting consolidation transactions" << std::endl;
+        broadcast_tree_result success = u.txdb ()->broadcast (*proof);
+        if (!success) throw exception {} << "could not broadcast because " << success;
+
+        std::cout << "broadcast successful!" << std::endl;
+        u.set_wallet (next);
+    });
+}
@@ -0,0 +1,404 @@
+#include <data/encoding/hex.hpp>
+#include <data/encoding/base64.hpp>
+#include <Cosmos/network.hpp>
+#include "interface.hpp"
+#include "Cosmos.hpp"
+
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+namespace Cosmos {
+
+    namespace {
+
+        using local = net::asio::local::stream_protocol;
+
+        // JSON-RPC 2.0 error codes.
+        enum rpc_code : int {
+            parse_error = -32700,
+            invalid_request = -32600,
+            method_not_found = -32601,
+            invalid_params = -32602,
+            // anything that goes wrong in the wallet itself.
+            wallet_error = -32000
+        };
+
+        struct rpc_error {
+            rpc_code Code;
+            std::string Message;
+        };
+
+        // The Interface is loaded once and kept in memory. All requests
+        // are handled on one thread and hold Lock for as long as they use
+        // the Interface, so changes to the wallet happen one at a time.
+        // Changes are written to disk on a separate thread.
+        struct server {
+            Interface &I;
+            options Options;
+            std::chrono::seconds FlushInterval;
+
+            net::asio::io_context IO {};
+            local::acceptor Acceptor;
+
+            std::mutex Lock {};
+
+            // held while files are being written so that
+            // snapshots are written in the order they were taken.
+            std::mutex Writing {};
+
+            std::condition_variable Wake {};
+            bool Stopping {false};
+
+            server (Interface &i, const options &o, std::chrono::seconds flush_interval, const std::string &socket_path) :
+                I {i}, Options {o}, FlushInterval {flush_interval}, Acceptor {IO, local::endpoint {socket_path}} {}
+
+            void accept ();
+
+            // write changes to disk every FlushInterval until we stop.
+            void flush ();
+
+            // one line of JSON in, one line of JSON out.
+            JSON handle (const std::string &line);
+
+            JSON call (const std::string &method, const JSON &params);
+
+            void stop ();
+        };
+
+        struct session : std::enable_shared_from_this<session> {
+            server &Server;
+            local::socket Socket;
+            net::asio::streambuf Buffer {};
+            std::string Response {};
+
+            session (server &d, local::socket &&s) : Server {d}, Socket {std::move (s)} {}
+
+            void read ();
+            void respond (const std::string &line);
+        };
+
+        void session::read () {
+            net::asio::async_read_until (Socket, Buffer, '\n',
+                [self = shared_from_this ()] (auto err, size_t) {
+                    // the client has disconnected.
+                    if (err) return;
+
+                    std::istream in {&self->Buffer};
+                    std::string line;
+                    std::getline (in, line);
+
+                    if (line.size () == 0) self->read ();
+                    else self->respond (line);
+                });
+        }
+
+        void session::respond (const std::string &line) {
+            Response = Server.handle (line).dump () + "\n";
+            net::asio::async_write (Socket, net::asio::buffer (Response),
+                [self = shared_from_this ()] (auto err, size_t) {
+                    if (self->Server.Stopping) self->Server.IO.stop ();
+                    else if (!err) self->read ();
+                });
+        }
+
+        void server::accept () {
+            Acceptor.async_accept ([this] (auto err, local::socket s) {
+                if (err) return;
+                std::make_shared<session> (*this, std::move (s))->read ();
+                accept ();
+            });
+        }
+
+        void server::flush () {
+            while (true) {
+                list<entry<std::string, JSON>> files;
+                std::unique_lock<std::mutex> writing {Writing, std::defer_lock};
+
+                {
+                    std::unique_lock<std::mutex> lock {Lock};
+                    Wake.wait_for (lock, FlushInterval, [this] {
+                        return Stopping;
+                    });
+
+                    // anything left over is saved when the Interface is destroyed.
+                    if (Stopping) return;
+                    if (!I.written ()) continue;
+
+                    writing.lock ();
+                    files = I.snapshot ();
+                }
+
+                // requests can go on while we write.
+                for (const entry<std::string, JSON> &f : files) write_to_file (f.Value, f.Key);
+            }
+        }
+
+        void server::stop () {
+            Stopping = true;
+            Wake.notify_all ();
+        }
+
+        JSON response (const JSON &id, const JSON &result) {
+            JSON::object_t r;
+            r["jsonrpc"] = "2.0";
+            r["id"] = id;
+            r["result"] = result;
+            return r;
+        }
+
+        JSON error_response (const JSON &id, int code, const std::string &message) {
+            JSON::object_t err;
+            err["code"] = code;
+            err["message"] = message;
+
+            JSON::object_t r;
+            r["jsonrpc"] = "2.0";
+            r["id"] = id;
+            r["error"] = err;
+            return r;
+        }
+
+        JSON server::handle (const std::string &line) {
+            JSON id = nullptr;
+            try {
+                JSON request;
+                try {
+                    request = JSON::parse (line);
+                } catch (const JSON::exception &) {
+                    throw rpc_error {parse_error, "could not parse request"};
+                }
+
+                if (!request.is_object () || !request.contains ("method") || !request["method"].is_string ())
+                    throw rpc_error {invalid_request, "invalid request"};
+
+                if (request.contains ("id")) id = request["id"];
+
+                JSON params = request.contains ("params") ? request["params"] : JSON (JSON::object_t {});
+                if (!params.is_object ()) throw rpc_error {invalid_params, "params must be an object"};
+
+                std::lock_guard<std::mutex> lock {Lock};
+                return response (id, call (std::string (request["method"]), params));
+
+            } catch (const rpc_error &x) {
+                return error_response (id, x.Code, x.Message);
+            } catch (const JSON::exception &x) {
+                return error_response (id, invalid_params, x.what ());
+            } catch (const std::exception &x) {
+                return error_response (id, wallet_error, x.what ());
+            } catch (...) {
+                return error_response (id, wallet_error, "unknown error");
+            }
+        }
+
+        JSON write_value (Bitcoin::satoshi x) {
+            JSON::object_t r;
+            r["value"] = int64 (x);
+            return r;
+        }
+
+        JSON server::call (const std::string &method, const JSON &params) {
+
+            if (method == "value") {
+                auto w = I.wallet ();
+                if (!bool (w)) throw exception {} << "could not read wallet";
+                return write_value (w->value ());
+            }
+
+            if (method == "update") {
+                bool rescan = params.contains ("rescan") && bool (params["rescan"]);
+                I.update<void> ([rescan] (Interface::writable u) {
+                    update_pending_transactions (u);
+                    if (rescan) update_restored_sequences (u);
+                });
+
+                return write_value (I.wallet ()->value ());
+            }
+
+            if (method == "request") {
+                payments::request request {Bitcoin::timestamp::now ()};
+
+                if (params.contains ("expires"))
+                    request.Expires = Bitcoin::timestamp {uint32 (request.Created) + uint32 (params["expires"]) * 60};
+
+                if (params.contains ("amount")) request.Amount = Bitcoin::satoshi {int64 (params["amount"])};
+
+                if (params.contains ("memo")) request.Memo = std::string (params["memo"]);
+
+                payments::type payment_option = payments::type::address;
+                if (params.contains ("payment_type")) {
+                    maybe<payments::type> read_option = read_payment_type (sanitize (std::string (params["payment_type"])));
+                    if (!bool (read_option)) throw rpc_error {invalid_params, "could not read payment type"};
+                    payment_option = *read_option;
+                }
+
+                auto pr = I.update<payments::payment_request> ([&request, &payment_option] (Interface::writable u) {
+                    return make_payment_request (u, payment_option, request);
+                });
+
+                JSON::object_t r;
+                r["request"] = payments::write_payment_request (pr);
+                return r;
+            }
+
+            if (method == "pay") {
+                maybe<Bitcoin::satoshi> amount;
+                if (params.contains ("amount")) amount = Bitcoin::satoshi {int64 (params["amount"])};
+
+                maybe<std::string> memo;
+                if (params.contains ("memo")) memo = std::string (params["memo"]);
+
+                maybe<payments::payment_request> pr;
+                if (params.contains ("request")) {
+                    // the request may be given as an object or as a string.
+                    const JSON &j = params["request"];
+                    pr = payments::read_payment_request (j.is_string () ? JSON::parse (std::string (j)) : j);
+
+                    if (bool (pr->Value.Amount) && bool (amount) && *pr->Value.Amount != *amount)
+                        throw rpc_error {invalid_params, "amount provided in payment request and as an option and do not agree"};
+
+                    if (bool (pr->Value.Memo) && bool (memo) && *pr->Value.Memo != *memo)
+                        throw rpc_error {invalid_params, "memo provided in payment request and as an option and do not agree"};
+                } else if (params.contains ("address"))
+                    pr = payments::payment_request {std::string (params["address"]), payments::request {}};
+                else throw rpc_error {invalid_params, "no payment request or address provided"};
+
+                if (!bool (pr->Value.Amount)) {
+                    if (!bool (amount)) throw rpc_error {invalid_params, "no amount provided"};
+                    pr->Value.Amount = *amount;
+                }
+
+                if (!bool (pr->Value.Memo) && bool (memo)) pr->Value.Memo = *memo;
+
+                I.update<void> (update_pending_transactions);
+
+                if (I.wallet ()->value () < *pr->Value.Amount)
+                    throw exception {} << "Wallet does not have sufficient funds to make this payment";
+
+                BEEF beef = I.update<BEEF> ([&pr, this] (Interface::writable u) -> BEEF {
+                    return make_payment (u, *pr, Options);
+                });
+
+                JSON::object_t r;
+                r["beef"] = encoding::base64::write (bytes (beef));
+                return r;
+            }
+
+            if (method == "accept") {
+                if (!params.contains ("payment")) throw rpc_error {invalid_params, "no payment provided"};
+
+                // we only take payments as BEEF here, in hex or base 64.
+                std::string payment_string {params["payment"]};
+                maybe<bytes> payment_bytes = encoding::hex::read (payment_string);
+                if (!bool (payment_bytes)) payment_bytes = encoding::base64::read (payment_string);
+                if (!bool (payment_bytes)) throw rpc_error {invalid_params, "could not read payment"};
+
+                BEEF beef {*payment_bytes};
+                if (!beef.valid ()) throw rpc_error {invalid_params, "payment is not valid BEEF"};
+
+                incoming_payment accepted = I.update<incoming_payment> ([&beef] (Interface::writable u) {
+                    SPV::proof p = beef.read_SPV_proof (*u.local_txdb ());
+                    if (!p.validate (*u.local_txdb ())) throw exception {} << "failed to validate SPV proof";
+                    if (p.Payment.size () == 0) throw exception {} << "no payment found";
+
+                    // there is nobody to ask, so we take any payment that pays one of our requests.
+                    return accept_payment (u, p, [] (const incoming_payment &x) -> bool {
+                        return x.RequestsSatisfied.size () > 0;
+                    });
+                });
+
+                JSON::array_t requests;
+                for (const auto &[id, req, paid] : accepted.RequestsSatisfied) {
+                    JSON::object_t satisfied;
+                    satisfied["id"] = id;
+                    satisfied["paid"] = int64 (paid);
+                    requests.push_back (satisfied);
+                }
+
+                JSON::object_t r;
+                r["value"] = int64 (accepted.Value);
+                r["requests"] = requests;
+                return r;
+            }
+
+            // write everything now rather than waiting for the flush thread.
+            if (method == "flush") {
+                std::lock_guard<std::mutex> writing {Writing};
+                I.save ();
+                return nullptr;
+            }
+
+            if (method == "stop") {
+                stop ();
+                return nullptr;
+            }
+
+            throw rpc_error {method_not_found, "unknown method " + method};
+        }
+    }
+}
+
+void command_daemon (const arg_parser &p) {
+    using namespace Cosmos;
+    Interface e {};
+    read_wallet_options (e, p);
+    read_random_options (p);
+
+    // there is nobody to press enter before we broadcast.
+    e.net ()->Interactive = false;
+
+    maybe<std::string> socket_path;
+    p.get ("socket", socket_path);
+    if (!bool (socket_path)) {
+        if (!bool (e.wallet_name ())) throw exception {1} << "need a wallet name or a socket path";
+        socket_path = *e.wallet_name () + ".sock";
+    }
+
+    maybe<uint32> flush_interval;
+    p.get ("flush_interval", flush_interval);
+
+    options opts = read_tx_options (e, p);
+
+    // a socket file left over from a previous run would stop us from binding.
+    // We only remove it if it is a socket and nobody is listening on it.
+    if (std::filesystem::exists (*socket_path)) {
+        if (!std::filesystem::is_socket (*socket_path))
+            throw exception {1} << *socket_path << " exists and is not a socket";
+
+        bool listening = true;
+        try {
+            net::asio::io_context io {};
+            local::socket s {io};
+            s.connect (local::endpoint {*socket_path});
+        } catch (const std::exception &) {
+            listening = false;
+        }
+
+        if (listening) throw exception {1} << "a daemon is already listening on " << *socket_path;
+
+        std::filesystem::remove (*socket_path);
+    }
+
+    server d {e, opts, std::chrono::seconds {bool (flush_interval) ? *flush_interval : 5}, *socket_path};
+
+    std::cout << "listening on " << *socket_path << std::endl;
+
+    std::thread flusher {[&d] {
+        d.flush ();
+    }};
+
+    d.accept ();
+    d.IO.run ();
+
+    {
+        std::lock_guard<std::mutex> lock {d.Lock};
+        d.stop ();
+    }
+
+    flusher.join ();
+    std::filesystem::remove (*socket_path);
+
+    std::cout << "daemon stopped" << std::endl;
+}
@@ -0,0 +1,71 @@
+#include <Cosmos/export.hpp>
+#include "interface.hpp"
+#include "Cosmos.hpp"
+#include <fstream>
+
+void command_export (const arg_parser &p) {
+    using namespace Cosmos;
+
+    maybe<std::string> what;
+    p.get (3, "what", what);
+    if (!bool (what)) throw exception {1} << "need to say what to export: history or taxes";
+
+    std::string export_what = sanitize (*what);
+    if (export_what != "history" && export_what != "taxes")
+        throw exception {1} << "cannot export " << *what << "; use history or taxes";
+
+    maybe<std::string> output;
+    p.get (4, "output", output);
+    if (!bool (output)) throw exception {1} << "no output file given";
+
+    maybe<std::string> format_string;
+    p.get ("format", format_string);
+    maybe<export_format> format = bool (format_string) ? read_export_format (*format_string) : export_format::csv;
+    if (!bool (format)) throw exception {1} << "could not read format " << *format_string << "; use csv or ndjson";
+
+    when from = when::negative_infinity ();
+    when to = when::infinity ();
+
+    maybe<uint32> from_time;
+    maybe<uint32> to_time;
+    maybe<uint32> year;
+    p.get ("from", from_time);
+    p.get ("to", to_time);
+    p.get ("year", year);
+
+    if (bool (year)) {
+        std::tm tm_begin = {0, 0, 0, 1, 0, int (*year) - 1900};
+        std::tm tm_end = {0, 0, 0, 1, 0, int (*year) - 1900 + 1};
+        from = Bitcoin::timestamp {std::mktime (&tm_begin)};
+        to = Bitcoin::timestamp {std::mktime (&tm_end)};
+    }
+
+    if (bool (from_time)) from = Bitcoin::timestamp {*from_time};
+    if (bool (to_time)) to = Bitcoin::timestamp {*to_time};
+
+    Interface e {};
+    read_watch_wallet_options (e, p);
+
+    const auto *h = e.history ();
+    if (h == nullptr) throw exception {} << "could not read wallet history";
+
+    if (export_what == "taxes") e.update<void> ([] (Cosmos::Interface::writable u) {
+        auto *l = u.ledger ();
+        if (l == nullptr) throw exception {} << "could not read tax ledger";
+
+        u.history ()->update (*u.local_txdb ());
+        if (size_t unconfirmed = l->update (*u.history (), *u.price_data ()); unconfirmed > 0)
+            std::cout << "WARNING: " << unconfirmed << " unconfirmed txs are not included. Run update to check for confirmations." << std::endl;
+    });
+
+    // the file is opened last so that it is not truncated if anything above fails.
+    std::ofstream file {*output};
+    if (!file) throw exception {} << "could not open " << *output;
+
+    exporter x {file, *format};
+
+    if (export_what == "history") x.history (*h, from, to);
+    else x.ledger (*e.ledger (), from, to);
+
+    std::cout << "exported " << *what << " to " << *output << std::endl;
+}
@@ -17,15 +17,21 @@ namespace Cosmos {
         maybe<double> min_sats_per_output;
         maybe<double> mean_sats_per_output;
         maybe<double> fee_rate;
+        maybe<uint32> max_outputs_per_tx;
+        maybe<uint64> max_tx_size;
 
         p.get ("min_sats_per_output", min_sats_per_output);
         p.get ("max_sats_per_output", max_sats_per_output);
         p.get ("mean_sats_per_output", mean_sats_per_output);
         p.get ("fee_rate", fee_rate);
+        p.get ("max_outputs_per_tx", max_outputs_per_tx);
+        p.get ("max_tx_size", max_tx_size);
 
         if (bool (max_sats_per_output)) o.MaxSatsPerOutput = std::ceil (*max_sats_per_output);
         if (bool (min_sats_per_output)) o.MinSatsPerOutput = std::ceil (*min_sats_per_output);
         if (bool (mean_sats_per_output)) o.MeanSatsPerOutput = *mean_sats_per_output;
+        if (bool (max_outputs_per_tx)) o.MaxOutputsPerTx = *max_outputs_per_tx;
+        if (bool (max_tx_size)) o.MaxTxSize = *max_tx_size;
 
         maybe<satoshis_per_byte> sats_per_byte;
         if (bool (fee_rate)) *sats_per_byte = {Bitcoin::satoshi {int64 (ceil (*fee_rate * 1000))}, 1000};
@@ -57,23 +63,49 @@ namespace Cosmos {
 
     }
 
+    Cosmos::wallet without_proposals (const Cosmos::wallet &w, const Cosmos::payments *p) {
+        if (!bool (p)) throw exception {} << "could not load payments";
+        account_builder pruned_account {w.Account};
+        // a batch payment may appear in several proposals, so each diff is applied only once.
+        set<Bitcoin::TXID> applied;
+        for (const auto &[_, offer] : p->Proposals) for (const auto &diff : offer.Diff)
+            if (!applied.contains (diff.TXID)) {
+                pruned_account <<= diff;
+                applied = applied.insert (diff.TXID);
+            }
+
+        // unsigned txs have no txid yet, so their outputs can't be spent.
+        // We only remove the outputs that they spend.
+        for (const auto &[_, offer] : p->Unsigned) for (const auto &diff : offer.Diff)
+            try {
+                pruned_account <<= account_diff {diff.TXID, {}, diff.Remove};
+            } catch (const account::cannot_apply_diff &) {
+                // the outputs are already gone, so there's nothing to protect.
+            }
+
+        return Cosmos::wallet {w.Pubkeys, w.Addresses, pruned_account.finalize ()};
+    }
+
     spend::spent Interface::writable::make_tx (list<Bitcoin::output> o, const options &opts) {
         auto *k = I.keys ();
         maybe<Cosmos::wallet> w = I.wallet ();
 
         if (!bool (k) || !bool (w)) throw exception {} << "could not load wallet";
 
-        // remove all pending payments from the account so that we don't
-        // accidentally invalidate them with this payment.
-        auto *p = I.payments ();
-        if (!bool (p)) throw exception {} << "could not load payments";
-        Cosmos::account pruned_account = w->Account;
-        for (const auto &[_, offer] : p->Proposals) for (const auto diff : offer.Diff) pruned_account <<= diff;
+        return spend {
+            select_down {4, 5000, .5, 5},
+            split_change_parameters {opts}, *get_casual_random ()}
+            (Gigamonkey::redeem_p2pkh_and_p2pk, *k, without_proposals (*w, I.payments ()), o);
+    }
+
+    spend::spent_unsigned Interface::writable::make_unsigned_tx (list<Bitcoin::output> o, const options &opts) {
+        maybe<Cosmos::wallet> w = I.wallet ();
+        if (!bool (w)) throw exception {} << "could not load wallet";
 
         return spend {
             select_down {4, 5000, .5, 5},
             split_change_parameters {opts}, *get_casual_random ()}
-            (Gigamonkey::redeem_p2pkh_and_p2pk, *k, Cosmos::wallet {w->Pubkeys, w->Addresses, pruned_account}, o);
+            (nosig::p2pkh_and_p2pk, without_proposals (*w, I.payments ()), o);
     }
 
     void update_pending_transactions (Interface::writable u) {
@@ -88,20 +120,35 @@ namespace Cosmos {
         auto unconfirmed = txdb->unconfirmed ();
 
         std::cout << " found " << unconfirmed.size () << " unconfirmed txs." << std::endl;
-        for (const Bitcoin::TXID &txid : unconfirmed) if ((*txdb)[txid]->confirmed ()) mined <<= txid;
+
+        // check all unconfirmed txs and all txs in proposals at once.
+        list<Bitcoin::TXID> check;
+        for (const Bitcoin::TXID &txid : unconfirmed) check <<= txid;
+        for (const auto &proposal : p->Proposals)
+            for (const auto &diff : proposal.Value.Diff) check <<= diff.TXID;
+
+        set<Bitcoin::TXID> found = txdb->import_transactions (check);
+
+        for (const Bitcoin::TXID &txid : unconfirmed)
+            if (auto tx = txdb->Local.transaction (txid); tx.valid () && tx.confirmed ()) mined <<= txid;
         std::cout << " of these " << mined.size () << " were mined since the last time the program was run." << std::endl;
 
         // update the unconfirmed txs in history.
         auto *h = u.history ();
+        if (mined.size () > 0) h->update (*txdb);
 
         // look for payments that have been made which have been accepted by the network.
-        Cosmos::account pruned_account = w->Account;
+        account_builder pruned_account {w->Account};
         map<string, payments::offer> new_proposals {};
+
+        // txs from batch payments are shared between proposals.
+        set<Bitcoin::TXID> applied;
         for (const auto &proposal : p->Proposals) {
             bool broadcast = true;
             list<Bitcoin::TXID> ids;
             for (const auto diff : proposal.Value.Diff)
-                if (txdb->import_transaction (diff.TXID)) {
+                if (applied.contains (diff.TXID)) ids <<= diff.TXID;
+                else if (found.contains (diff.TXID)) {
                     // catching an error means that we have already accounted for this tx in our account.
                     try {
                         pruned_account <<= diff;
@@ -110,6 +157,7 @@ namespace Cosmos {
                     }
 
                     ids <<= diff.TXID;
+                    applied = applied.insert (diff.TXID);
 
                     auto v = (*txdb)[diff.TXID];
 
@@ -124,11 +172,53 @@ namespace Cosmos {
             if (!broadcast) new_proposals = new_proposals.insert (proposal);
         }
 
-        u.set_payments (Cosmos::payments {p->Requests, new_proposals});
+        u.set_payments (Cosmos::payments {p->Requests, new_proposals, p->Unsigned});
         std::cout << " done updating." << std::endl;
 
     }
 
+    void update_restored_sequences (Interface::writable u) {
+        auto *rp = u.get ().restore_progress ();
+
+        // nothing has been restored, so there is nothing to rescan.
+        if (!bool (rp) || rp->Sequences.size () == 0) return;
+
+        auto w = u.get ().wallet ();
+        auto txdb = u.txdb ();
+        if (!bool (w) || !bool (txdb)) throw exception {"could not load wallet"};
+
+        std::cout << "Checking restored address sequences for new transactions" << std::endl;
+
+        restore::result rescanned = restore {options::DefaultMaxLookAhead, false}.rescan (*txdb, w->Addresses.Sequences, *rp);
+
+        account_builder next_account {w->Account};
+        Cosmos::addresses next_addresses = w->Addresses;
+        auto *h = u.history ();
+        size_t found = 0;
+
+        for (const auto &[name, restored] : rescanned.Restored) {
+            // txs that we made ourselves are already in the account.
+            for (const account_diff &d : restored.Account) try {
+                next_account <<= d;
+            } catch (const account::cannot_apply_diff &) {
+                std::cout << "  WARNING: could not apply tx " << d.TXID << " to the account; it may already be there." << std::endl;
+            }
+
+            // events are put in order as they are added and events for the same tx in
+            // different sequences are combined, so sequences can be added one at a time.
+            *h <<= restored.History;
+            found += restored.History.size ();
+            if (restored.Last > next_addresses.Sequences[name].Last)
+                next_addresses = next_addresses.update (name, restored.Last);
+        }
+
+        u.set_wallet (Cosmos::wallet {w->Pubkeys, next_addresses, next_account.finalize ()});
+        u.set_restore_progress (rescanned.Progress);
+
+        if (bool (rescanned.Error)) std::cout << " could not finish checking restored sequences: " << *rescanned.Error << std::endl;
+        else std::cout << " found " << found << " new events." << std::endl;
+    }
+
     broadcast_tree_result Interface::writable::broadcast (list<std::pair<Bitcoin::transaction, account_diff>> payment) {
 
         auto w = I.wallet ();
@@ -136,7 +226,9 @@ namespace Cosmos {
         Cosmos::wallet next_wallet = *w;
 
         // this will throw an exception if any of the diffs are incompatible.
-        for (const auto &[_, diff] : payment) next_wallet.Account <<= diff;
+        account_builder next_account {next_wallet.Account};
+        for (const auto &[_, diff] : payment) next_account <<= diff;
+        next_wallet.Account = next_account.finalize ();
 
         // we assume that the proof exists and can be generated.
         auto success = txdb ()->broadcast (
@@ -275,6 +367,26 @@ namespace Cosmos {
         return PaymentsFilepath;
     }
 
+    maybe<std::string> &Interface::restore_filepath () {
+        if (!bool (RestoreFilepath) && bool (Name)) {
+            std::stringstream ss;
+            ss << *Name << ".restore.json";
+            RestoreFilepath = ss.str ();
+        }
+
+        return RestoreFilepath;
+    }
+
+    maybe<std::string> &Interface::ledger_filepath () {
+        if (!bool (LedgerFilepath) && bool (Name)) {
+            std::stringstream ss;
+            ss << *Name << ".ledger.json";
+            LedgerFilepath = ss.str ();
+        }
+
+        return LedgerFilepath;
+    }
+
     network *Interface::net () {
         if (!bool (Net)) Net = std::make_shared<network> ();
 
@@ -396,9 +508,29 @@ namespace Cosmos {
         return Payments.get ();
     }
 
+    restore_progress *Interface::get_restore_progress () {
+        if (!bool (RestoreProgress)) {
+            auto rf = restore_filepath ();
+            if (bool (rf)) RestoreProgress = std::make_shared<Cosmos::restore_progress> (read_from_file (*rf).Payload);
+        }
+
+        return RestoreProgress.get ();
+    }
+
+    ledger *Interface::get_ledger () {
+        if (!bool (Ledger)) {
+            auto lf = ledger_filepath ();
+            if (bool (lf)) Ledger = std::make_shared<Cosmos::ledger> (read_from_file (*lf).Payload);
+        }
+
+        return Ledger.get ();
+    }
+
     Interface::~Interface () {
-        if (!Written) return;
+        if (Written) save ();
+    }
 
+    list<entry<std::string, JSON>> Interface::snapshot () {
         auto tf = txdb_filepath ();
         auto af = account_filepath ();
         auto df = addresses_filepath ();
@@ -407,25 +539,39 @@ namespace Cosmos {
         auto kf = keychain_filepath ();
         auto pdf = price_data_filepath ();
         auto yf = payments_filepath ();
+        auto rf = restore_filepath ();
+        auto lf = ledger_filepath ();
+
+        list<entry<std::string, JSON>> files;
 
         if (bool (tf) && bool (LocalTXDB))
-            write_to_file (JSON (dynamic_cast<JSON_local_TXDB &> (*LocalTXDB)), *tf);
+            files <<= entry<std::string, JSON> {*tf, JSON (dynamic_cast<JSON_local_TXDB &> (*LocalTXDB))};
+
+        if (bool (af) && bool (Account)) files <<= entry<std::string, JSON> {*af, JSON (*Account)};
 
-        if (bool (af) && bool (Account)) write_to_file (JSON (*Account), *af);
+        if (bool (df) && bool (Addresses)) files <<= entry<std::string, JSON> {*df, JSON (*Addresses)};
 
-        if (bool (df) && bool (Addresses)) write_to_file (JSON (*Addresses), *df);
+        if (bool (hf) && bool (Events)) files <<= entry<std::string, JSON> {*hf, JSON (*Events)};
 
-        if (bool (hf) && bool (Events)) write_to_file (JSON (*Events), *hf);
+        if (bool (pf) && bool (Pubkeys)) files <<= entry<std::string, JSON> {*pf, JSON (*Pubkeys)};
 
-        if (bool (pf) && bool (Pubkeys)) write_to_file (JSON (*Pubkeys), *pf);
+        if (bool (yf) && bool (Payments)) files <<= entry<std::string, JSON> {*yf, JSON (*Payments)};
 
-        if (bool (yf) && bool (Payments)) write_to_file (JSON (*Payments), *yf);
+        if (bool (rf) && bool (RestoreProgress)) files <<= entry<std::string, JSON> {*rf, JSON (*RestoreProgress)};
 
-        if (bool (kf) && bool (Keys)) write_to_file (JSON (*Keys), *kf);
+        if (bool (lf) && bool (Ledger)) files <<= entry<std::string, JSON> {*lf, JSON (*Ledger)};
+
+        if (bool (kf) && bool (Keys)) files <<= entry<std::string, JSON> {*kf, JSON (*Keys)};
 
         if (bool (pdf) && bool (LocalPriceData))
-            write_to_file (JSON (dynamic_cast<JSON_price_data &> (*LocalPriceData)), *pdf);
+            files <<= entry<std::string, JSON> {*pdf, JSON (dynamic_cast<JSON_price_data &> (*LocalPriceData))};
+
+        Written = false;
+        return files;
+    }
 
+    void Interface::save () {
+        for (const entry<std::string, JSON> &f : snapshot ()) write_to_file (f.Value, f.Key);
     }
 
 }
@@ -7,9 +7,12 @@
 
 #include <Cosmos/wallet/wallet.hpp>
 #include <Cosmos/wallet/split.hpp>
+#include <Cosmos/wallet/restore.hpp>
+#include <Cosmos/wallet/keys/pool.hpp>
 #include <Cosmos/database/json/price_data.hpp>
 #include <Cosmos/database/json/txdb.hpp>
 #include <Cosmos/history.hpp>
+#include <Cosmos/ledger.hpp>
 #include <Cosmos/random.hpp>
 
 using arg_parser = data::io::arg_parser;
@@ -30,6 +33,8 @@ namespace Cosmos {
         maybe<std::string> &account_filepath ();
         maybe<std::string> &events_filepath ();
         maybe<std::string> &payments_filepath ();
+        maybe<std::string> &restore_filepath ();
+        maybe<std::string> &ledger_filepath ();
 
         network *net ();
 
@@ -39,8 +44,10 @@ namespace Cosmos {
         const Cosmos::price_data *price_data () const;
 
         const Cosmos::history *history () const;
+        const Cosmos::ledger *ledger () const;
         const Cosmos::addresses *addresses () const;
         const Cosmos::payments *payments () const;
+        const Cosmos::restore_progress *restore_progress () const;
 
         const Cosmos::keychain *keys () const;
         const Cosmos::pubkeys *pubkeys () const;
@@ -63,12 +70,24 @@ namespace Cosmos {
         // We use this to change the database.
         struct writable {
 
+            network *net ();
+
             Cosmos::local_TXDB *local_txdb ();
             Cosmos::cached_remote_TXDB *txdb ();
             SPV::database *spvdb ();
             Cosmos::price_data *price_data ();
 
             Cosmos::history *history ();
+            Cosmos::ledger *ledger ();
+
+            // addresses derived from xpub payment requests. This is not saved
+            // but is kept for as long as the Interface so that it is only
+            // derived once by a running daemon.
+            address_pool *xpub_pool ();
+
+            // addresses derived from every sequence in the wallet, kept like the
+            // xpub pool and extended whenever a sequence has been used further.
+            address_pool *wallet_pool ();
 
             void set_keys (const Cosmos::keychain &);
             void set_pubkeys (const Cosmos::pubkeys &);
@@ -77,6 +96,7 @@ namespace Cosmos {
 
             void set_wallet (const Cosmos::wallet &);
             void set_payments (const Cosmos::payments &);
+            void set_restore_progress (const Cosmos::restore_progress &);
 
             // broadcast a series of transactions with account diffs
             // to update in the wallet. Optionally, an SPV::proof::map
@@ -87,6 +107,9 @@ namespace Cosmos {
             // make a transaction with a bunch of default options already set
             spend::spent make_tx (list<Bitcoin::output> o, const options & = {});
 
+            // the same but without keys. The tx is signed later with the sign command.
+            spend::spent_unsigned make_unsigned_tx (list<Bitcoin::output> o, const options & = {});
+
             const Cosmos::Interface &get () {
                 return I;
             }
@@ -98,6 +121,19 @@ namespace Cosmos {
             friend struct Cosmos::Interface;
         };
 
+        // write everything that has been loaded to disk. This happens
+        // automatically on destruction if anything has been changed.
+        void save ();
+
+        // everything that save would write along with the files to write it to.
+        // Writing the files can then be done without holding on to the Interface.
+        list<entry<std::string, JSON>> snapshot ();
+
+        // whether anything has been changed since the last save.
+        bool written () const {
+            return Written;
+        }
+
         ~Interface ();
 
     private:
@@ -111,6 +147,8 @@ namespace Cosmos {
         maybe<std::string> PriceDataFilepath {};
         maybe<std::string> HistoryFilepath {};
         maybe<std::string> PaymentsFilepath {};
+        maybe<std::string> RestoreFilepath {};
+        maybe<std::string> LedgerFilepath {};
 
         ptr<network> Net {nullptr};
         ptr<Cosmos::keychain> Keys {nullptr};
@@ -123,6 +161,10 @@ namespace Cosmos {
         ptr<Cosmos::account> Account {nullptr};
         ptr<Cosmos::addresses> Addresses {nullptr};
         ptr<Cosmos::payments> Payments {nullptr};
+        ptr<Cosmos::restore_progress> RestoreProgress {nullptr};
+        ptr<Cosmos::ledger> Ledger {nullptr};
+        ptr<address_pool> XpubPool {nullptr};
+        ptr<address_pool> WalletPool {nullptr};
 
         // if this is set to true, then everything will be
         // saved to disk on destruction of the Interface.
@@ -137,6 +179,8 @@ namespace Cosmos {
         Cosmos::history *get_history ();
         Cosmos::addresses *get_addresses ();
         Cosmos::payments *get_payments ();
+        Cosmos::restore_progress *get_restore_progress ();
+        Cosmos::ledger *get_ledger ();
 
         maybe<Cosmos::wallet> get_wallet ();
 
@@ -149,8 +193,35 @@ namespace Cosmos {
 
     void update_pending_transactions (Interface::writable);
 
+    // remove all pending payments, signed or not, from the account so
+    // that we don't accidentally invalidate them with a new payment.
+    Cosmos::wallet without_proposals (const Cosmos::wallet &, const Cosmos::payments *);
+
+    // look for new txs in address sequences that have already been restored
+    // since the height at which they were last checked.
+    void update_restored_sequences (Interface::writable);
+
     void restore_wallet (Interface &e);
 
+    maybe<payments::type> read_payment_type (const std::string &);
+
+    // generate a new payment request and save it in the wallet.
+    payments::payment_request make_payment_request (Interface::writable, payments::type, const payments::request &);
+
+    // make a tx paying a payment request and save it as a proposal.
+    // The tx is not broadcast; the payee does that if they accept it.
+    BEEF make_payment (Interface::writable, const payments::payment_request &, const options &);
+
+    // what we would get from accepting a payment.
+    struct incoming_payment {
+        Bitcoin::satoshi Value;
+        list<tuple<string, payments::request, Bitcoin::satoshi>> RequestsSatisfied;
+    };
+
+    // approve is called before anything is broadcast. If it returns false,
+    // an exception is thrown and the payment is not accepted.
+    incoming_payment accept_payment (Interface::writable, const SPV::proof &, function<bool (const incoming_payment &)> approve);
+
     void read_both_chains_options (Interface &, const arg_parser &p);
     void read_pubkeys_options (Interface &, const arg_parser &p);
     void read_account_and_txdb_options (Interface &, const arg_parser &p);
@@ -185,6 +256,10 @@ namespace Cosmos {
         read_account_and_txdb_options (e, p);
     }
 
+    network inline *Interface::writable::net () {
+        return I.net ();
+    }
+
     cached_remote_TXDB inline *Interface::writable::txdb () {
         return I.get_txdb ();
     }
@@ -197,6 +272,23 @@ namespace Cosmos {
         return I.get_history ();
     }
 
+    ledger inline *Interface::writable::ledger () {
+        return I.get_ledger ();
+    }
+
+    address_pool inline *Interface::writable::xpub_pool () {
+        if (!bool (I.XpubPool)) I.XpubPool = std::make_shared<address_pool> ();
+        return I.XpubPool.get ();
+    }
+
+    address_pool inline *Interface::writable::wallet_pool () {
+        const Cosmos::addresses *a = I.addresses ();
+        if (!bool (a)) return nullptr;
+        if (!bool (I.WalletPool)) I.WalletPool = std::make_shared<address_pool> (*a);
+        else I.WalletPool->extend (*a);
+        return I.WalletPool.get ();
+    }
+
     price_data inline *Interface::writable::price_data () {
         return I.get_price_data ();
     }
@@ -241,6 +333,14 @@ namespace Cosmos {
         return const_cast<Interface *> (this)->get_payments ();
     }
 
+    const ledger inline *Interface::ledger () const {
+        return const_cast<Interface *> (this)->get_ledger ();
+    }
+
+    const restore_progress inline *Interface::restore_progress () const {
+        return const_cast<Interface *> (this)->get_restore_progress ();
+    }
+
     void inline Interface::writable::set_keys (const Cosmos::keychain &kk) {
         if (I.Keys) *I.Keys = kk;
         else I.Keys = std::make_shared<Cosmos::keychain> (kk);
@@ -272,6 +372,11 @@ namespace Cosmos {
         else I.Payments = std::make_shared<Cosmos::payments> (pk);
     }
 
+    void inline Interface::writable::set_restore_progress (const Cosmos::restore_progress &rp) {
+        if (I.RestoreProgress) *I.RestoreProgress = rp;
+        else I.RestoreProgress = std::make_shared<Cosmos::restore_progress> (rp);
+    }
+
 }
 
 #endif
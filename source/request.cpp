@@ -1,6 +1,27 @@
 #include "interface.hpp"
 #include "Cosmos.hpp"
 
+namespace Cosmos {
+
+    maybe<payments::type> read_payment_type (const std::string &payment_option) {
+        if (payment_option == "address") return payments::type::address;
+        if (payment_option == "pubkey") return payments::type::pubkey;
+        if (payment_option == "xpub") return payments::type::xpub;
+        return {};
+    }
+
+    payments::payment_request make_payment_request (Interface::writable u, payments::type t, const payments::request &request) {
+        const auto *addrs = u.get ().addresses ();
+        const auto *pay = u.get ().payments ();
+        if (!bool (addrs) || !bool (pay)) throw exception {} << "could not read wallet";
+
+        auto pr = payments::request_payment (t, *pay, *addrs, request);
+        u.set_addresses (pr.Addresses);
+        u.set_payments (pr.Payments);
+        return pr.Request;
+    }
+}
+
 void command_request (const arg_parser &p) {
     using namespace Cosmos;
     Cosmos::Interface e {};
@@ -25,28 +46,22 @@ void command_request (const arg_parser &p) {
     maybe<std::string> payment_option_string;
     p.get ("payment_type", payment_option_string);
 
-    payments::type payment_option = bool (payment_option_string) ?
-        [] (const std::string &payment_option) -> payments::type {
-            std::cout << "payment type is " << payment_option << std::endl;
-            if (payment_option == "address") return payments::type::address;
-            if (payment_option == "pubkey") return payments::type::pubkey;
-            if (payment_option == "xpub") return payments::type::xpub;
-            throw exception {} << "could not read payment type";
-        } (sanitize (*payment_option_string)) : payments::type::address;
+    payments::type payment_option = payments::type::address;
+    if (bool (payment_option_string)) {
+        std::cout << "payment type is " << sanitize (*payment_option_string) << std::endl;
+        maybe<payments::type> read_option = read_payment_type (sanitize (*payment_option_string));
+        if (!bool (read_option)) throw exception {} << "could not read payment type";
+        payment_option = *read_option;
+    }
 
     if (payment_option == payments::type::xpub || payment_option == payments::type::pubkey)
         std::cout << "NOTE: the payment type you have chosen is not safe against a quantum attack. "
             "Please don't use it if you think your customer may have access to a quantum computer." << std::endl;
 
-    e.update<void> ([&request, &payment_option] (Cosmos::Interface::writable u) {
-        const auto *addrs = u.get ().addresses ();
-        const auto *pay = u.get ().payments ();
-        if (!bool (addrs) || !bool (pay)) throw exception {} << "could not read wallet";
-
-        auto pr = payments::request_payment (payment_option, *pay, *addrs, request);
-        std::cout << "Show the following string to your customer to request payment. " << std::endl;
-        std::cout << "\t" << payments::write_payment_request (pr.Request) << std::endl;
-        u.set_addresses (pr.Addresses);
-        u.set_payments (pr.Payments);
+    auto pr = e.update<payments::payment_request> ([&request, &payment_option] (Cosmos::Interface::writable u) {
+        return make_payment_request (u, payment_option, request);
     });
+
+    std::cout << "Show the following string to your customer to request payment. " << std::endl;
+    std::cout << "\t" << payments::write_payment_request (pr) << std::endl;
 }
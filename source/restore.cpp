@@ -4,9 +4,47 @@
 #include "interface.hpp"
 #include "Cosmos.hpp"
 
+namespace Cosmos {
+
+    // download the history of a wallet that was restored with --utxo_first.
+    // txs containing unspent outputs are already in the database and will not
+    // be downloaded again. The account is already complete, so we only keep the history.
+    void backfill_history (const arg_parser &p) {
+        Interface e {};
+        read_watch_wallet_options (e, p);
+
+        maybe<uint32> max_look_ahead;
+        p.get ("max_look_ahead", max_look_ahead);
+        if (!bool (max_look_ahead)) max_look_ahead = options::DefaultMaxLookAhead;
+
+        const restore_progress *progress = e.restore_progress ();
+        auto w = e.wallet ();
+        if (!bool (progress) || !bool (w)) throw exception {1} << "could not load wallet; run restore first";
+
+        maybe<std::string> error = e.update<maybe<std::string>> (
+            [&max_look_ahead, &w, progress] (Cosmos::Interface::writable u) {
+                restore::result result = restore {*max_look_ahead, false}.backfill (*u.txdb (), w->Addresses.Sequences, *progress);
+
+                for (const auto &[name, restored] : result.Restored)
+                    *u.history () <<= restored.History;
+
+                // progress is saved even if we were interrupted so that we can continue from here.
+                u.set_restore_progress (result.Progress);
+                return result.Error;
+            });
+
+        if (bool (error)) throw exception {} << "could not download history because " << *error <<
+            "; progress has been saved. Run restore --backfill again to continue.";
+
+        std::cout << "History restored." << std::endl;
+    }
+}
+
 void command_restore (const arg_parser &p) {
     using namespace Cosmos;
 
+    if (p.has ("backfill")) return backfill_history (p);
+
     // somehow we need to get this key to be valid.
     HD::BIP_32::pubkey pk;
 
@@ -345,40 +383,84 @@ void command_restore (const arg_parser &p) {
 
     Interface e {};
 
-    auto restore_from_pubkey = [&max_look_ahead, &w] (Cosmos::Interface::writable u) {
-        events history {};
-        for (const auto &[name, sequence] : w.Addresses.Sequences) {
-            std::cout << "checking address sequence " << name << std::endl;
-            auto restored = restore {*max_look_ahead, false} (*u.txdb (), sequence);
-            w.Account = fold ([] (const account a, const account_diff &d) -> account {
-                return a << d;
-            }, w.Account, restored.Account);
-            history = history + restored.History;
-            w.Addresses = w.Addresses.update (name, restored.Last);
-            std::cout << "done checking address sequence " << name << std::endl;
+    // with this option, we first restore only the unspent outputs so that the
+    // wallet can be used right away, and then we go back to get the history.
+    bool utxo_first = p.has ("utxo_first");
+
+    // the sequences as they were before the restore.
+    map<string, address_sequence> sequences = w.Addresses.Sequences;
+
+    // returns an error if the restore was interrupted. Whatever was found before
+    // that is saved along with the progress so that we can continue later.
+    auto restore_from_pubkey = [&max_look_ahead, &w, &sequences, utxo_first]
+        (Cosmos::Interface::writable u) -> maybe<std::string> {
+
+        const restore_progress *saved = u.get ().restore_progress ();
+        restore_progress progress = bool (saved) ? *saved : restore_progress {};
+
+        // if a restore was already started, we continue from the wallet that it saved.
+        Cosmos::wallet restored_wallet = w;
+        if (progress.Sequences.size () > 0)
+            if (maybe<Cosmos::wallet> existing = u.get ().wallet (); bool (existing)) {
+                std::cout << "continuing previous restore" << std::endl;
+                restored_wallet = *existing;
+            }
+
+        std::cout << "checking " << sequences.size () << " address sequences" << std::endl;
+        restore rr {*max_look_ahead, false};
+        // all sequences are checked at once.
+        restore::result result = utxo_first ?
+            rr.unspent (*u.txdb (), sequences, progress) :
+            rr (*u.txdb (), sequences, progress);
+
+        account_builder restored_account {restored_wallet.Account};
+        for (const auto &[name, restored] : result.Restored) {
+            // outputs spent by txs that we found in a previous run may not be in the account.
+            for (const account_diff &d : restored.Account) try {
+                restored_account <<= d;
+            } catch (const account::cannot_apply_diff &) {
+                std::cout << "  WARNING: could not apply tx " << d.TXID << " to the account; it may already be there." << std::endl;
+            }
+
+            // events are put in order as they are added.
+            *u.history () <<= restored.History;
+            restored_wallet.Addresses = restored_wallet.Addresses.update (name, restored.Last);
         }
 
-        u.set_wallet (w);
+        restored_wallet.Account = restored_account.finalize ();
+        u.set_wallet (restored_wallet);
+        u.set_restore_progress (result.Progress);
 
-        // There is a potential problem here because if a history already
-        // exists we will throw an error if we try to put histories together
-        // out of order. The restore command really only works with a new wallet.
-        auto &h = *u.history ();
-        h <<= history;
+        return result.Error;
     };
 
-    auto restore_from_privkey = [&sk, &restore_from_pubkey] (Cosmos::Interface::writable u) {
-        restore_from_pubkey (u);
+    auto restore_from_privkey = [&sk, &restore_from_pubkey] (Cosmos::Interface::writable u) -> maybe<std::string> {
+        maybe<std::string> err = restore_from_pubkey (u);
         u.set_keys (u.get ().keys ()->insert (*sk));
+        return err;
     };
 
+    maybe<std::string> error;
     if (bool (sk)) {
         read_wallet_options (e, p);
-        e.update<void> (restore_from_privkey);
+        error = e.update<maybe<std::string>> (restore_from_privkey);
     } else {
         read_watch_wallet_options (e, p);
-        e.update<void> (restore_from_pubkey);
+        error = e.update<maybe<std::string>> (restore_from_pubkey);
     }
 
+    // write the wallet now so that it can be used while the history is being downloaded.
+    e.save ();
+
+    if (bool (error)) throw exception {} << "restore interrupted because " << *error <<
+        "; progress has been saved. Run restore again to continue.";
+
     std::cout << "Wallet restred. Total funds: " << e.wallet ()->value () << std::endl;
+
+    // a restore that was started with --utxo_first may still need its history.
+    bool incomplete = false;
+    if (const restore_progress *progress = e.restore_progress (); bool (progress))
+        for (const auto &[_, x] : progress->Sequences) if (x.Done && !x.HistoryComplete) incomplete = true;
+
+    if (incomplete) std::cout << "The wallet can now be used. Run restore --backfill to download the rest of its history." << std::endl;
 }
@@ -1,3 +1,5 @@
+#include <Cosmos/wallet/fan_out.hpp>
+#include <Cosmos/parallel.hpp>
 #include "interface.hpp"
 #include "Cosmos.hpp"
 
@@ -268,82 +270,104 @@ void command_split (const arg_parser &p) {
 
     e.update<void> ([&split, &top, &opts] (Cosmos::Interface::writable u) {
 
-        auto &txdb = *u.txdb ();
+        fan_out planner {opts};
 
-        struct split_result {
-            // the data to broadcast.
-            SPV::proof Proof {};
+        wallet original = *u.get ().wallet ();
+        const keychain &keys = *u.get ().keys ();
 
-            // the new wallet if the broadcast succeeds.
-            wallet Wallet {};
+        // a split of a single script along with the addresses reserved for it.
+        struct planned_split {
+            list<entry<Bitcoin::outpoint, redeemable>> Outputs;
+            fan_out::node Plan;
+            address_sequence Addresses;
         };
 
-        list<split_result> split_txs;
+        // planning is quick and uses the random number generator, so it is done first,
+        // one script at a time. We know exactly how many addresses each plan will use,
+        // so each one gets its own range of the change sequence.
+        std::vector<planned_split> plans;
+        address_sequence change = original.Addresses.change ();
 
-        split_result next {};
-        next.Wallet = *u.get ().wallet ();
+        while (!top.empty ()) {
+            const auto &t = top.first ();
 
-        int number_of_transactions {0};
-        size_t total_size {0};
-        Bitcoin::satoshi total_fee {0};
+            std::cout << " Splitting script with hash " << t.ScriptHash << " containing value " << t.Value << " over " <<
+                t.Outputs.size () << " output" << (t.Outputs.size () == 1 ? "" : "s") << "." << std::endl;
 
-        {
-            while (!top.empty ()) {
-                const auto &t = top.first ();
-
-                std::cout << " Splitting script with hash " << t.ScriptHash << " containing value " << t.Value << " over " <<
-                    t.Outputs.size () << " output" << (t.Outputs.size () == 1 ? "" : "s") << "." << std::endl;
-
-                spend::spent spent = split (Gigamonkey::redeem_p2pkh_and_p2pk, *get_random (),
-                    *u.get ().keys (), next.Wallet, t.Outputs, double (opts.FeeRate));
-
-                account new_account = next.Wallet.Account;
-
-                std::cout << " Produced " << spent.Transactions.size () << " transactions " << std::endl;
-                list<Bitcoin::transaction> txs;
-
-                // each split may give us several new transactions to work with.
-                for (const auto &[extx, diff] : spent.Transactions) {
-                    auto txid = extx.id ();
-                    if (!extx.valid ()) throw exception {} << "WARNING: tx " << txid << " is not valid.";
-                    Bitcoin::transaction tx = Bitcoin::transaction (extx);
-                    new_account <<= diff;
-                    txs <<= tx;
-                    number_of_transactions++;
-                    size_t size = tx.serialized_size ();
-                    total_size += size;
-                    Bitcoin::satoshi fee = extx.fee ();
-                    total_fee += fee;
-                    std::cout << "  " << txid << "\n  of size " << size <<
-                        " with " << tx.Outputs.size () << " outputs and " << fee << " in fees." << std::endl;
-                }
+            Bitcoin::satoshi value {0};
+            uint64 inputs_size {0};
+            for (const auto &[_, re] : t.Outputs) {
+                value += re.Prevout.Value;
+                inputs_size += re.expected_input_size ();
+            }
 
-                next = split_result {*SPV::generate_proof (*u.txdb (), txs),
-                    wallet {next.Wallet.Pubkeys, spent.Addresses, new_account}};
+            fan_out::node plan = planner.plan (split, *get_random (), value, t.Outputs.size (), inputs_size, double (opts.FeeRate));
+            plans.push_back (planned_split {t.Outputs, plan, change});
+            change = address_sequence {change.Parent, change.Path, change.Last + plan.addresses ()};
 
-                split_txs <<= next;
+            top = top.rest ();
+        }
+
+        // the splits spend different outputs and use different addresses, so
+        // we can build and sign them all at once. Each one signs on a single thread.
+        std::vector<fan_out::result> fanned = parallel_map<fan_out::result> (plans.size (),
+            [&planner, &plans, &keys, &original] (size_t i) -> fan_out::result {
+                const planned_split &ps = plans[i];
+                return planner.build (ps.Plan, Gigamonkey::redeem_p2pkh_and_p2pk,
+                    keys, original.Pubkeys, ps.Addresses, ps.Outputs, 1);
+            });
 
-                top = top.rest ();
+        // every tx from every script, in an order such that each tx comes after those it spends.
+        list<Bitcoin::transaction> txs;
+
+        int number_of_transactions {0};
+        size_t total_size {0};
+        Bitcoin::satoshi total_fee {0};
+
+        account_builder new_account {original.Account};
+
+        // merge the results in the order in which they were planned.
+        for (const fan_out::result &result : fanned) {
+            std::cout << " Produced " << result.Transactions.size () << " transactions " << std::endl;
+            for (const auto &[extx, diff] : result.Transactions) {
+                auto txid = extx.id ();
+                if (!extx.valid ()) throw exception {} << "WARNING: tx " << txid << " is not valid.";
+                Bitcoin::transaction tx = Bitcoin::transaction (extx);
+                new_account <<= diff;
+                txs <<= tx;
+                number_of_transactions++;
+                size_t size = tx.serialized_size ();
+                total_size += size;
+                Bitcoin::satoshi fee = extx.fee ();
+                total_fee += fee;
+                std::cout << "  " << txid << "\n  of size " << size <<
+                    " with " << tx.Outputs.size () << " outputs and " << fee << " in fees." << std::endl;
             }
         }
 
+        wallet next {original.Pubkeys, original.Addresses.update (original.Addresses.Change, change.Last), new_account.finalize ()};
+
         std::cout << "Transactions have been generated!" << std::endl;
         std::cout << "  number of transactions: " << number_of_transactions << std::endl;
         std::cout << "  total size: " << total_size << std::endl;
         std::cout << "  total fees: " << total_fee << std::endl;
 
+        // all txs are broadcast together in a single proof. The database
+        // is not safe to use from several threads so this is done afterwards.
+        maybe<SPV::proof> proof = SPV::generate_proof (*u.txdb (), txs);
+        if (!bool (proof)) throw exception {} << "could not generate SPV proof for split transactions";
+
         if (!get_user_yes_or_no ("Do you want broadcast these transactions?")) throw exception {} << "program aborted";
 
         std::cout << "broadcasting split transactions" << std::endl;
-        for (const auto &sp : split_txs) {
-            broadcast_tree_result success = u.txdb ()->broadcast (sp.Proof);
-            if (!success) {
-                // TODO we should analize the result more here but we will do that
-                // inside the broadcast method for now.
-                throw exception {} << "could not broadcast because " << success;
-            }
-            std::cout << "broadcast successful!" << std::endl;
-            u.set_wallet (sp.Wallet);
+        broadcast_tree_result success = u.txdb ()->broadcast (*proof);
+        if (!success) {
+            // TODO we should analize the result more here but we will do that
+            // inside the broadcast method for now.
+            throw exception {} << "could not broadcast because " << success;
         }
+
+        std::cout << "broadcast successful!" << std::endl;
+        u.set_wallet (next);
     });
 }